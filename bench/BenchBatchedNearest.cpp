@@ -0,0 +1,112 @@
+// Per-pair cost of matching every query midpoint through the KD-tree:
+// one search per midpoint in swc order, as scoring used to, against
+// NeuronIndex::nearestAll() walking the query in Morton order with each
+// search bounded by the previous one. Skeletons are subdivided to reach
+// the size of full FAFB reconstructions, which fctraces20 is far below.
+//
+//   obj/bench/BenchBatchedNearest [swcDirectory] [subdivisions] [repetitions]
+
+#include "FileIO.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
+#include "Point.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// splits every edge into pieces equal parts
+static PointVector subdivide(const PointVector& points, int pieces) {
+    PointVector out(points);
+    int nextID = 0;
+    for (const auto& p : points) nextID = std::max(nextID, p.id + 1);
+    for (size_t i = 0; i < points.size(); ++i) {
+        int parent = points[i].parent;
+        if (parent == POINT_DEFAULT_PARENT) continue;
+        const Point& from = points[parent];
+        const Point& to = points[i];
+        for (int k = 1; k < pieces; ++k) {
+            double t = static_cast<double>(k) / pieces;
+            out.emplace_back(nextID++, from.x + t * (to.x - from.x), from.y + t * (to.y - from.y),
+                             from.z + t * (to.z - from.z), parent);
+            parent = static_cast<int>(out.size() - 1);
+        }
+        out[i].parent = parent;
+    }
+    return out;
+}
+
+// best of repetitions, in seconds
+template<typename F>
+static double bestOf(unsigned repetitions, F&& run) {
+    double best = std::numeric_limits<double>::max();
+    for (unsigned r = 0; r < repetitions; ++r) {
+        TimerStats ts;
+        timeFunction(ts, run);
+        best = std::min(best, ts.getTotal());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory = argc > 1 ? argv[1] : "regression-tests/input/fctraces20-swc";
+    int pieces = argc > 2 ? std::stoi(argv[2]) : 16;
+    unsigned repetitions = argc > 3 ? std::stoul(argv[3]) : 5;
+
+    std::vector<Neuron> neurons;
+    for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+        if (entry.path().extension() != ".swc") continue;
+        Neuron n = makeNeuron(subdivide(loadPoints(entry.path().string()), pieces));
+        ensureIndex(n);
+        neurons.push_back(std::move(n));
+    }
+    if (neurons.size() < 2) {
+        std::cerr << "need at least two swc files in " << directory << "\n";
+        return 1;
+    }
+    // the largest few, every ordered pair of them
+    std::sort(neurons.begin(), neurons.end(), [](const Neuron& a, const Neuron& b) { return a.size() > b.size(); });
+    neurons.resize(std::min<size_t>(neurons.size(), 6));
+
+    std::cout << "ms per pair, best of " << repetitions << "\n";
+    std::cout << std::setw(8) << "query" << std::setw(8) << "target" << std::setw(10) << "swc order"
+              << std::setw(10) << "batched" << std::setw(9) << "speedup\n";
+    double totalSerial = 0, totalBatched = 0;
+    std::vector<size_t> nearestIdx;
+    std::vector<coord_t> distSqr;
+    for (const auto& query : neurons) {
+        for (const auto& target : neurons) {
+            if (&query == &target) continue;
+            size_t serialSum = 0, batchedSum = 0;
+            double serial = bestOf(repetitions, [&]() {
+                serialSum = 0;
+                for (const auto& qmp : query.midpoints) {
+                    coord_t pt[3] = { qmp.x, qmp.y, qmp.z };
+                    coord_t d;
+                    serialSum += target.index->nearestInTree(pt, d);
+                }
+            });
+            double batched = bestOf(repetitions, [&]() {
+                target.index->nearestAll(query.midpoints, query.index->curveOrder(), nearestIdx, distSqr);
+                batchedSum = 0;
+                for (size_t idx : nearestIdx) batchedSum += idx;
+            });
+            if (serialSum != batchedSum) {
+                std::cerr << "batched search disagrees with the tree\n";
+                return 1;
+            }
+            totalSerial += serial;
+            totalBatched += batched;
+            std::cout << std::setw(8) << query.size() << std::setw(8) << target.size() << std::fixed
+                      << std::setprecision(3) << std::setw(10) << serial * 1e3 << std::setw(10) << batched * 1e3
+                      << std::setprecision(2) << std::setw(8) << serial / batched << "x\n";
+        }
+    }
+    std::cout << "overall speedup: " << std::setprecision(2) << totalSerial / totalBatched << "x\n";
+    return 0;
+}
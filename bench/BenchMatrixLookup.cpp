@@ -0,0 +1,111 @@
+// Matrix::score lookups per second, against the nested-vector table with
+// linear bin scans and bounds-checked .at() it replaced, and through the
+// FixedMatrix copy Matrix::visit() hands out for known layouts, over the
+// distances and angles scoring actually produces for fctraces20 pairs.
+//
+//   obj/bench/BenchMatrixLookup [matrix.tsv] [swcDirectory] [repetitions]
+
+#include "Matrix.hpp"
+#include "MatrixIO.hpp"
+#include "Neuron.hpp"
+#include "Point.hpp"
+#include "Scoring.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// the previous layout and lookup, kept here as the baseline
+class NestedMatrix {
+    public:
+        explicit NestedMatrix(const Matrix& mat)
+            : distanceBins(mat.getDistanceBins()), angleBins(mat.getAngleBins()),
+              table(mat.rows(), DoubleVector(mat.cols())) {
+            for (size_t i = 0; i < mat.rows(); ++i) {
+                for (size_t j = 0; j < mat.cols(); ++j) table[i][j] = mat.at(i, j);
+            }
+        }
+        double score(double distance, double angle) const {
+            int row = findBin(distanceBins, distance);
+            int col = findBin(angleBins, angle);
+            return table.at(row).at(col);
+        }
+    private:
+        DoubleVector distanceBins;
+        DoubleVector angleBins;
+        DoubleVector2D table;
+
+        static int findBin(const DoubleVector& bins, double value) {
+            for (size_t i = 0; i < bins.size(); ++i) {
+                if (value <= bins[i]) return i;
+            }
+            return bins.size() - 1;
+        }
+};
+
+// lookups per second, best of repetitions
+template<typename M>
+static double lookupsPerSecond(const M& mat, const PAVector& matches, unsigned repetitions, double& checksum) {
+    double best = std::numeric_limits<double>::max();
+    for (unsigned r = 0; r < repetitions; ++r) {
+        TimerStats ts;
+        double sum = 0;
+        timeFunction(ts, [&]() {
+            for (const auto& m : matches) sum += mat.score(m.distance, m.angleMeasure);
+        });
+        best = std::min(best, ts.getTotal());
+        checksum = sum;
+    }
+    return matches.size() / best;
+}
+
+int main(int argc, char* argv[]) {
+    std::string matrixPath = argc > 1 ? argv[1] : "regression-tests/input/smat.fcwb.tsv";
+    std::string directory = argc > 2 ? argv[2] : "regression-tests/input/fctraces20-swc";
+    unsigned repetitions = argc > 3 ? std::stoul(argv[3]) : 20;
+
+    Matrix mat = MatrixIO::loadMatrixFromTSV(matrixPath);
+    NestedMatrix nested(mat);
+
+    std::vector<Neuron> neurons;
+    for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+        if (entry.path().extension() == ".swc") neurons.push_back(loadNeuron(entry.path().string()));
+    }
+    PAVector matches;
+    for (const auto& query : neurons) {
+        for (const auto& target : neurons) {
+            for (const auto& m : nearestNeighborKDTree(query, target)) {
+                if (m.angleMeasure >= 0) matches.push_back(m);
+            }
+        }
+    }
+    if (matches.empty()) {
+        std::cerr << "no swc files in " << directory << "\n";
+        return 1;
+    }
+
+    double nestedSum = 0, flatSum = 0, fixedSum = 0;
+    double before = lookupsPerSecond(nested, matches, repetitions, nestedSum);
+    double after = lookupsPerSecond(mat, matches, repetitions, flatSum);
+    double fixed = mat.visit([&](const auto& scorer) {
+        return lookupsPerSecond(scorer, matches, repetitions, fixedSum);
+    });
+    if (nestedSum != flatSum || nestedSum != fixedSum) {
+        std::cerr << "lookups disagree\n";
+        return 1;
+    }
+    std::cout << matches.size() << " lookups x " << repetitions << "\n" << std::fixed << std::setprecision(1)
+              << "nested, linear scan: " << before / 1e6 << " M/s\n"
+              << "flat, branch-free:   " << after / 1e6 << " M/s (" << std::setprecision(2)
+              << after / before << "x)\n";
+    if (mat.isFixed()) {
+        std::cout << std::setprecision(1) << "fixed layout:        " << fixed / 1e6 << " M/s (" 
+                  << std::setprecision(2) << fixed / before << "x)\n";
+    }
+    return 0;
+}
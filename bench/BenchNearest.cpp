@@ -0,0 +1,101 @@
+// Nearest-neighbour query cost of the SIMD brute-force kernels against
+// a prebuilt KD-tree, over targets of growing size. The crossover each
+// kernel prints is the size up to which NeuronIndex scans instead of
+// walking the tree (BruteForceKernel::maxPoints).
+//
+//   obj/bench/BenchNearest [swcDirectory] [repetitions]
+
+#include "BruteForceNN.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
+#include "Point.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// nanoseconds per query point, best of repetitions
+template<typename F>
+static double nsPerQuery(const PointVector& queries, unsigned repetitions, F&& nearest) {
+    TimerStats ts;
+    double best = std::numeric_limits<double>::max();
+    size_t checksum = 0;
+    for (unsigned r = 0; r < repetitions; ++r) {
+        TimerStats run;
+        timeFunction(run, [&]() {
+            for (const auto& q : queries) {
+                coord_t pt[3] = { q.x, q.y, q.z };
+                coord_t distSqr;
+                checksum += nearest(pt, distSqr);
+            }
+        });
+        best = std::min(best, run.getTotal());
+    }
+    // keep the searches observable
+    if (checksum == 1) std::cerr << "\n";
+    return best * 1e9 / queries.size();
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory = argc > 1 ? argv[1] : "regression-tests/input/fctraces20-swc";
+    unsigned repetitions = argc > 2 ? std::stoul(argv[2]) : 20;
+
+    // every midpoint of the dataset queries prefixes of its largest neuron
+    PointVector queries;
+    Neuron largest;
+    for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+        if (entry.path().extension() != ".swc") continue;
+        Neuron n = loadNeuron(entry.path().string());
+        queries.insert(queries.end(), n.midpoints.begin(), n.midpoints.end());
+        if (n.size() > largest.size()) largest = std::move(n);
+    }
+    if (queries.empty()) {
+        std::cerr << "no swc files in " << directory << "\n";
+        return 1;
+    }
+
+    const auto& kernels = supportedBruteForceKernels();
+    std::cout << "queries: " << queries.size() << " x " << repetitions << ", ns per query\n";
+    std::cout << std::setw(8) << "targets" << std::setw(10) << "kdtree";
+    for (const auto* kernel : kernels) std::cout << std::setw(10) << kernel->name;
+    std::cout << "\n";
+
+    std::vector<size_t> crossover(kernels.size(), 0);
+    for (size_t size = 8; ; size = std::min(size * 3 / 2, largest.size())) {
+        PointVector targets(largest.midpoints.begin(), largest.midpoints.begin() + size);
+        NeuronIndex index(targets);
+        size_t padded = (size + BRUTE_FORCE_PADDING - 1) / BRUTE_FORCE_PADDING * BRUTE_FORCE_PADDING;
+        std::vector<coord_t> xs(padded, std::numeric_limits<coord_t>::quiet_NaN()), ys = xs, zs = xs;
+        for (size_t i = 0; i < size; ++i) {
+            xs[i] = targets[i].x;
+            ys[i] = targets[i].y;
+            zs[i] = targets[i].z;
+        }
+
+        double tree = nsPerQuery(queries, repetitions, [&](const coord_t* pt, coord_t& distSqr) {
+            return index.nearestInTree(pt, distSqr);
+        });
+        std::cout << std::setw(8) << size << std::setw(10) << std::fixed << std::setprecision(1) << tree;
+        for (size_t k = 0; k < kernels.size(); ++k) {
+            double scan = nsPerQuery(queries, repetitions, [&](const coord_t* pt, coord_t& distSqr) {
+                size_t nearestIdx = 0;
+                kernels[k]->nearest(xs.data(), ys.data(), zs.data(), padded, pt, nearestIdx, distSqr);
+                return nearestIdx;
+            });
+            if (scan < tree) crossover[k] = size;
+            std::cout << std::setw(10) << scan;
+        }
+        std::cout << "\n";
+        if (size == largest.size()) break;
+    }
+    for (size_t k = 0; k < kernels.size(); ++k) {
+        std::cout << kernels[k]->name << " crossover: " << crossover[k] 
+                  << " points (in use: " << kernels[k]->maxPoints << ")\n";
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Parse throughput of loadPoints against the previous two-pass
+// istringstream loader, over a directory of swc files.
+//
+//   obj/bench/BenchParse [swcDirectory] [repetitions]
+
+#include "FileIO.hpp"
+#include "Point.hpp"
+#include "Timer.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ================= previous loader =================
+static uint64_t legacyComputeLineCount(std::ifstream& fin) {
+    fin.seekg(0, std::ios::beg);
+    const size_t bufferSize = 1 << 20;
+    std::vector<char> buffer(bufferSize);
+    unsigned lineCount = 0;
+    while (fin) {
+        fin.read(buffer.data(), buffer.size());
+        std::streamsize bytes_read = fin.gcount();
+        for (std::streamsize i = 0; i < bytes_read; ++i) {
+            if (buffer[i] == '\n') ++lineCount;
+        }
+    }
+    fin.clear();
+    fin.seekg(0, std::ios::beg);
+    return lineCount + 1;
+}
+
+static PointVector legacyLoadPoints(const std::string& filepath) {
+    std::ifstream fin{filepath};
+    if (!fin) { throw std::runtime_error("Cannot open " + filepath); }
+    PointVector vec;
+    vec.resize(legacyComputeLineCount(fin));
+
+    std::string line;
+    size_t id = -1;
+    while (std::getline(fin, line)) {
+        if (line.empty()) continue;
+        if (!line.empty() && line[0] == '#') continue;
+        std::istringstream sin(line);
+        sin >> id;
+        Point p;
+        p.parse(line);
+        vec[id] = p;
+    }
+    return vec;
+}
+
+// ================= harness =================
+template<typename F>
+static double throughput(const std::vector<std::string>& filepaths, uint64_t totalBytes, 
+                         unsigned repetitions, F&& load) {
+    TimerStats ts;
+    size_t checksum = 0;
+    for (unsigned r = 0; r < repetitions; ++r) {
+        timeFunction(ts, [&]() {
+            for (const auto& filepath : filepaths) {
+                checksum += load(filepath).size();
+            }
+        });
+    }
+    // keep the loads observable
+    if (checksum == 0) std::cerr << "no points loaded\n";
+    return (static_cast<double>(totalBytes) * repetitions / (1 << 20)) / (ts.mean() * ts.getCount());
+}
+
+int main(int argc, char* argv[]) {
+    std::string directory = argc > 1 ? argv[1] : "regression-tests/input/fctraces20-swc";
+    unsigned repetitions = argc > 2 ? std::stoul(argv[2]) : 50;
+
+    std::vector<std::string> filepaths;
+    uint64_t totalBytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+        if (entry.path().extension() != ".swc") continue;
+        filepaths.push_back(entry.path().string());
+        totalBytes += entry.file_size();
+    }
+    if (filepaths.empty()) {
+        std::cerr << "no swc files in " << directory << "\n";
+        return 1;
+    }
+
+    double legacy = throughput(filepaths, totalBytes, repetitions, legacyLoadPoints);
+    double current = throughput(filepaths, totalBytes, repetitions, loadPoints);
+
+    std::cout << "swc files: " << filepaths.size() << " (" << totalBytes << " bytes) x " << repetitions << "\n";
+    std::cout << "legacy loadPoints: " << legacy << " MB/s\n";
+    std::cout << "loadPoints: " << current << " MB/s\n";
+    std::cout << "speedup: " << current / legacy << "x\n";
+    return 0;
+}
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# single precision build, scores must stay within TOLERANCE of the double reference
+TOLERANCE=2e-3
+
+make debug FLOAT32=1
+
+mkdir -p out
+
+QUERY_OUT=out/fctraces20-float32-test.out
+VERIFY=regression-tests/verify/fctraces20-test.out
+
+mapfile -t ids < <(awk '$1!="NA" && $1!="" {print $1}' "regression-tests/input/fctraces20-allbyall.tsv")
+
+n=${#ids[@]}
+
+{
+    for ((i=0; i<n; i++)); do
+        for ((j=i+1; j<n; j++)); do
+            echo -e "${ids[i]}\t${ids[j]}"
+        done
+    done
+} | ./nblast++-float32 -q "regression-tests/input/smat.fcwb.tsv" \
+-i "regression-tests/input/fctraces20-swc,regression-tests/input/fctraces20-swc" \
+ > "$QUERY_OUT"
+
+head -n "$(wc -l < "$VERIFY")" "$QUERY_OUT" | paste "$VERIFY" - | awk -F'\t' -v tol="$TOLERANCE" '
+    $1 != $4 || $2 != $5 { print "pair mismatch on line " NR; bad = 1; exit }
+    { d = $3 - $6; if (d < 0) d = -d; if (d > max) max = d }
+    END {
+        if (bad) exit 1
+        printf "max abs difference %g over %d pairs (tolerance %g)\n", max, NR, tol
+        exit max > tol
+    }'
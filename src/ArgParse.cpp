@@ -3,10 +3,13 @@
 #include "Logging.hpp"
 #include "StringUtils.hpp"
 
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <iostream>
 
 // C-based includes
+#include <getopt.h>
 #include <unistd.h>
 #include <cstring>
 #include <cassert>
@@ -17,6 +20,8 @@ std::ostream& operator<<(std::ostream& out, option_t op) {
     switch (op) {
         case option_t::Query: out << "q"; break;
         case option_t::GenerateScoringMatrix: out << "g"; break;
+        case option_t::Convert: out << "b"; break;
+        case option_t::AllByAll: out << "a"; break;
         case option_t::MatrixSpecified: out << "m"; break;
         case option_t::InputDirectoriesSpecified: out << "i"; break;
         case option_t::DumpIntermediarySteps: out << "d"; break;
@@ -31,6 +36,8 @@ std::string optToString(option_t m) {
     {
         case option_t::Query: return "q";
         case option_t::GenerateScoringMatrix: return "g";
+        case option_t::Convert: return "b";
+        case option_t::AllByAll: return "a";
         case option_t::MatrixSpecified: return "m";
         case option_t::InputDirectoriesSpecified: return "i";
         case option_t::DumpIntermediarySteps: return "d";
@@ -47,8 +54,18 @@ std::ostream& operator<<(std::ostream& out, const Args& a) {
         << "targetDatasetFilepath: " << a.targetDatasetFilepath << '\n'
         << "mode: " << a.mode << '\n'
         << "numGeneratorIterations: " << a.numGeneratorIterations << '\n'
+        << "cacheCapacityMiB: " << a.cacheCapacityMiB << '\n'
+        << "numThreads: " << a.numThreads << '\n'
+        << "lookaheadPairs: " << a.lookaheadPairs << '\n'
+        << "topK: " << a.topK << '\n'
+        << "coarseStep: " << a.coarseStep << '\n'
+        << "rescoreFraction: " << a.rescoreFraction << '\n'
+        << "resampleStep: " << a.resampleStep << '\n'
         << "doSine: " << a.doSine << '\n'
-        << "doDump: " << a.doDump;
+        << "doDump: " << a.doDump << '\n'
+        << "doPreload: " << a.doPreload << '\n'
+        << "useDatasetIndex: " << a.useDatasetIndex << '\n'
+        << "capFarMatches: " << a.capFarMatches;
     return out;
 }
 
@@ -67,7 +84,13 @@ Args parseArgs(int argc, char *argv[]) {
     Args a;
     int opt = 0;
     bool optIProvided = false;
-    while ((opt = getopt(argc, argv, ":hq:g:i:o:sd")) != -1) {
+    // long options have no short form, so they take values past any char
+    enum { OPT_RESAMPLE = 256 };
+    static const option longOptions[] = {
+        { "resample", required_argument, nullptr, OPT_RESAMPLE },
+        { nullptr, 0, nullptr, 0 }
+    };
+    while ((opt = getopt_long(argc, argv, ":hq:g:b:a:i:o:c:t:l:k:z:sdpxf", longOptions, nullptr)) != -1) {
         switch (opt) {
             // print usage
             case 'h': { printUsage(std::cout); exit(EXIT_SUCCESS); }
@@ -108,6 +131,26 @@ Args parseArgs(int argc, char *argv[]) {
                 
                 break;
             }
+            // convert toolchain, writes the query dataset's .swc files as binary 
+            // neurons into the target dataset directory, self-scored under the matrix
+            case 'b': {
+                setMode(a, option_t::Convert);
+                a.matrixFilepath = optarg;
+                if (a.matrixFilepath.empty()) {
+                    throw std::runtime_error("matrixFilepath cannot be empty");
+                }
+                break;
+            }
+            // all-by-all toolchain, scores every pair of neurons in one dataset
+            // and writes the symmetric score matrix
+            case 'a': {
+                setMode(a, option_t::AllByAll);
+                a.matrixFilepath = optarg;
+                if (a.matrixFilepath.empty()) {
+                    throw std::runtime_error("matrixFilepath cannot be empty");
+                }
+                break;
+            }
             // ===== options =====
             // input directories
             case 'i': {
@@ -131,9 +174,93 @@ Args parseArgs(int argc, char *argv[]) {
                 a.matrixOutfile = optarg;
                 break;
             }
+            // memory cap for the query mode neuron cache, in MiB
+            case 'c': {
+                uint64_t capacityMiB;
+                int rc = stringToUInt(optarg, capacityMiB);
+                if (rc == -1) {
+                    throw std::runtime_error("cache capacity must be an unsigned integer");
+                } else if (rc == -2 || capacityMiB > (SIZE_MAX >> 20)) {
+                    throw std::runtime_error("cache capacity out of range");
+                }
+                a.cacheCapacityMiB = capacityMiB;
+                break;
+            }
+            // worker threads for loading and scoring
+            case 't': {
+                uint64_t numThreads;
+                int rc = stringToUInt(optarg, numThreads);
+                if (rc == -1) {
+                    throw std::runtime_error("number of threads must be an unsigned integer");
+                } else if (rc == -2) {
+                    throw std::runtime_error("number of threads out of range");
+                }
+                a.numThreads = numThreads;
+                break;
+            }
+            // stdin pairs read ahead and prefetched
+            case 'l': {
+                uint64_t lookaheadPairs;
+                int rc = stringToUInt(optarg, lookaheadPairs);
+                if (rc == -1) {
+                    throw std::runtime_error("lookahead must be an unsigned integer");
+                } else if (rc == -2) {
+                    throw std::runtime_error("lookahead out of range");
+                }
+                a.lookaheadPairs = lookaheadPairs;
+                break;
+            }
+            // best targets per query, searched over the whole target dataset
+            case 'k': {
+                uint64_t topK;
+                int rc = stringToUInt(optarg, topK);
+                if (rc == -1) {
+                    throw std::runtime_error("number of top targets must be an unsigned integer");
+                } else if (rc == -2) {
+                    throw std::runtime_error("number of top targets out of range");
+                } else if (topK == 0) {
+                    throw std::runtime_error("number of top targets cannot be 0");
+                }
+                a.topK = topK;
+                break;
+            }
+            // all-by-all pairs ranked at a coarse voxel step, the best fraction rescored exactly
+            case 'z': {
+                std::pair<std::string, std::string> res;
+                int rc = splitOnComma(optarg, res);
+                if (rc) {
+                    throw std::runtime_error("argument for -z invalid, use -z step,fraction");
+                }
+                rc = stringToDouble(res.first, a.coarseStep);
+                if (rc || !(a.coarseStep > 0) || !std::isfinite(a.coarseStep)) {
+                    throw std::runtime_error("coarse step must be a positive number");
+                }
+                rc = stringToDouble(res.second, a.rescoreFraction);
+                if (rc || !(a.rescoreFraction >= 0 && a.rescoreFraction <= 1)) {
+                    throw std::runtime_error("rescore fraction must be a number from 0 to 1");
+                }
+                break;
+            }
+            // swc skeletons redrawn with evenly spaced points as they are loaded
+            case OPT_RESAMPLE: {
+                int rc = stringToDouble(optarg, a.resampleStep);
+                if (rc || !(a.resampleStep > 0) || !std::isfinite(a.resampleStep)) {
+                    throw std::runtime_error("resample step must be a positive number");
+                }
+                break;
+            }
             case 's': { a.doSine = true; break; }
             case 'd': { a.doDump = true; break; }
+            case 'p': { a.doPreload = true; break; }
+            // only score targets the target dataset's spatial index finds near each query
+            case 'x': { a.useDatasetIndex = true; break; }
+            // stop searches at the matrix's last distance bin edge, scoring
+            // anything beyond it as the mean of the last row
+            case 'f': { a.capFarMatches = true; break; }
             case ':': {
+                if (optopt == OPT_RESAMPLE) {
+                    throw std::runtime_error("option requires an argument --resample");
+                }
                 throw std::runtime_error(std::string("option requires an argument -") + static_cast<char>(optopt)); break;
             }
             case '?': {
@@ -146,10 +273,29 @@ Args parseArgs(int argc, char *argv[]) {
         throw std::runtime_error("The -q option requires -i to specify query and target datasets.");
     } else if (a.mode == option_t::GenerateScoringMatrix && !optIProvided) {
         throw std::runtime_error("The -g option requires -i to specify query and target datasets.");
+    } else if (a.mode == option_t::Convert && !optIProvided) {
+        throw std::runtime_error("The -b option requires -i to specify swc and binary dataset directories.");
+    } else if (a.mode == option_t::AllByAll && !optIProvided) {
+        throw std::runtime_error("The -a option requires -i to specify the dataset.");
+    } else if (a.mode == option_t::AllByAll && a.queryDatasetFilepath != a.targetDatasetFilepath) {
+        throw std::runtime_error("The -a option scores one dataset against itself, use -i dataset,dataset.");
     }
     for (int i = optind; i < argc; ++i) {
         a.positionalArgs.push_back(argv[i]);
     }
+    if (a.topK && a.mode != option_t::Query) {
+        throw std::runtime_error("The -k option is only valid with -q.");
+    } else if (a.topK && a.positionalArgs.empty()) {
+        throw std::runtime_error("The -k option requires one or more query neuron IDs.");
+    } else if (a.useDatasetIndex && a.mode != option_t::Query) {
+        throw std::runtime_error("The -x option is only valid with -q.");
+    } else if (a.useDatasetIndex && a.positionalArgs.empty()) {
+        throw std::runtime_error("The -x option requires one or more query neuron IDs.");
+    } else if (a.coarseStep > 0 && a.mode != option_t::AllByAll) {
+        throw std::runtime_error("The -z option is only valid with -a.");
+    } else if (a.capFarMatches && a.mode != option_t::Query && a.mode != option_t::AllByAll) {
+        throw std::runtime_error("The -f option is only valid with -q or -a.");
+    }
 
     return a;
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 enum class option_t : int {
     Query,
     GenerateScoringMatrix,
+    Convert,
+    AllByAll,
     Random,
     ComputeMatrix,
     MatrixSpecified,
@@ -28,8 +30,18 @@ struct Args {
     std::string matrixOutfile;
     option_t mode = option_t::DefaultMode;
     uint64_t numGeneratorIterations = 0;
+    uint64_t cacheCapacityMiB = 1024;
+    uint64_t numThreads = 0; // 0 = one per hardware thread
+    uint64_t lookaheadPairs = 16; // 0 = no prefetching
+    uint64_t topK = 0; // 0 = score the given pairs
+    double coarseStep = 0.0; // 0 = score every all-by-all pair at full resolution
+    double rescoreFraction = 1.0;
+    double resampleStep = 0.0; // 0 = segments as they are in the swc
     bool doSine = false;
     bool doDump = false;
+    bool doPreload = false;
+    bool useDatasetIndex = false;
+    bool capFarMatches = false;
 
     friend std::ostream& operator<<(std::ostream& out, const Args& a);
 };
@@ -0,0 +1,209 @@
+#include "BruteForceNN.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// the SIMD kernels are x86 only, elsewhere the scalar scan serves alone
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static bool nearestScalar(const coord_t* xs, const coord_t* ys, const coord_t* zs, size_t paddedCount, 
+                          const coord_t pt[3], size_t& nearestIdx, coord_t& distSqr) {
+    coord_t best = std::numeric_limits<coord_t>::infinity();
+    size_t bestIdx = 0;
+    bool tied = false;
+    for (size_t i = 0; i < paddedCount; ++i) {
+        coord_t dx = pt[0] - xs[i];
+        coord_t dy = pt[1] - ys[i];
+        coord_t dz = pt[2] - zs[i];
+        coord_t d = dx * dx + dy * dy + dz * dz;
+        if (d < best) {
+            best = d;
+            bestIdx = i;
+            tied = false;
+        } else if (d == best) {
+            tied = true;
+        }
+    }
+    nearestIdx = bestIdx;
+    distSqr = best;
+    return !tied;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Combines per-lane minima: unique only if a single lane holds the
+// smallest distance and that lane never saw it twice.
+template<size_t LANES>
+static bool reduceLanes(const coord_t (&best)[LANES], const coord_t (&bestIdx)[LANES], unsigned tiedMask, 
+                        size_t& nearestIdx, coord_t& distSqr) {
+    size_t lane = 0;
+    for (size_t l = 1; l < LANES; ++l) {
+        if (best[l] < best[lane]) lane = l;
+    }
+    if (best[lane] == std::numeric_limits<coord_t>::infinity()) return false;
+    for (size_t l = 0; l < LANES; ++l) {
+        if (l != lane && best[l] == best[lane]) return false;
+    }
+    nearestIdx = static_cast<size_t>(bestIdx[lane]);
+    distSqr = best[lane];
+    return !((tiedMask >> lane) & 1);
+}
+
+// ================= AVX2 =================
+// Thin overloads over the double and float intrinsics, so one kernel
+// body serves either coordinate type. AVX2 does not imply FMA, so the
+// compiler has no fused multiply-add to contract mul/add pairs into.
+#define AVX2_INLINE __attribute__((target("avx2"), always_inline)) static inline
+
+namespace avx2 {
+    AVX2_INLINE __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    AVX2_INLINE __m256 load(const float* p) { return _mm256_loadu_ps(p); }
+    AVX2_INLINE void store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    AVX2_INLINE void store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+    AVX2_INLINE __m256d set1(double v) { return _mm256_set1_pd(v); }
+    AVX2_INLINE __m256 set1(float v) { return _mm256_set1_ps(v); }
+    AVX2_INLINE __m256d iota(double) { return _mm256_setr_pd(0, 1, 2, 3); }
+    AVX2_INLINE __m256 iota(float) { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+    AVX2_INLINE __m256d sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    AVX2_INLINE __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+    AVX2_INLINE __m256d add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    AVX2_INLINE __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    AVX2_INLINE __m256d mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    AVX2_INLINE __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    AVX2_INLINE __m256d lt(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    AVX2_INLINE __m256 lt(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    AVX2_INLINE __m256d eq(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    AVX2_INLINE __m256 eq(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    AVX2_INLINE __m256d bitOr(__m256d a, __m256d b) { return _mm256_or_pd(a, b); }
+    AVX2_INLINE __m256 bitOr(__m256 a, __m256 b) { return _mm256_or_ps(a, b); }
+    AVX2_INLINE __m256d andNot(__m256d a, __m256d b) { return _mm256_andnot_pd(a, b); }
+    AVX2_INLINE __m256 andNot(__m256 a, __m256 b) { return _mm256_andnot_ps(a, b); }
+    AVX2_INLINE __m256d blend(__m256d a, __m256d b, __m256d mask) { return _mm256_blendv_pd(a, b, mask); }
+    AVX2_INLINE __m256 blend(__m256 a, __m256 b, __m256 mask) { return _mm256_blendv_ps(a, b, mask); }
+    AVX2_INLINE unsigned movemask(__m256d v) { return _mm256_movemask_pd(v); }
+    AVX2_INLINE unsigned movemask(__m256 v) { return _mm256_movemask_ps(v); }
+}
+
+__attribute__((target("avx2")))
+static bool nearestAVX2(const coord_t* xs, const coord_t* ys, const coord_t* zs, size_t paddedCount, 
+                        const coord_t pt[3], size_t& nearestIdx, coord_t& distSqr) {
+    using namespace avx2;
+    constexpr size_t LANES = 32 / sizeof(coord_t);
+    const auto qx = set1(pt[0]);
+    const auto qy = set1(pt[1]);
+    const auto qz = set1(pt[2]);
+    const auto step = set1(static_cast<coord_t>(LANES));
+    auto idx = iota(coord_t{});
+    auto best = set1(std::numeric_limits<coord_t>::infinity());
+    auto bestIdx = set1(coord_t{});
+    auto tied = set1(coord_t{});
+    for (size_t i = 0; i < paddedCount; i += LANES) {
+        auto dx = sub(qx, load(xs + i));
+        auto dy = sub(qy, load(ys + i));
+        auto dz = sub(qz, load(zs + i));
+        auto d = add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz));
+        auto closer = lt(d, best);
+        tied = bitOr(andNot(closer, tied), eq(d, best));
+        best = blend(best, d, closer);
+        bestIdx = blend(bestIdx, idx, closer);
+        idx = add(idx, step);
+    }
+    coord_t laneBest[LANES], laneIdx[LANES];
+    store(laneBest, best);
+    store(laneIdx, bestIdx);
+    return reduceLanes(laneBest, laneIdx, movemask(tied), nearestIdx, distSqr);
+}
+
+// ================= AVX-512 =================
+// The explicitly rounded add/mul forms cannot be contracted into fused
+// multiply-adds, which would round unlike the KD-tree metric.
+#define AVX512_INLINE __attribute__((target("avx512f"), always_inline)) static inline
+
+namespace avx512 {
+    constexpr int ROUND_NEAREST = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+    AVX512_INLINE __m512d load(const double* p) { return _mm512_loadu_pd(p); }
+    AVX512_INLINE __m512 load(const float* p) { return _mm512_loadu_ps(p); }
+    AVX512_INLINE void store(double* p, __m512d v) { _mm512_storeu_pd(p, v); }
+    AVX512_INLINE void store(float* p, __m512 v) { _mm512_storeu_ps(p, v); }
+    AVX512_INLINE __m512d set1(double v) { return _mm512_set1_pd(v); }
+    AVX512_INLINE __m512 set1(float v) { return _mm512_set1_ps(v); }
+    AVX512_INLINE __m512d iota(double) { return _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7); }
+    AVX512_INLINE __m512 iota(float) { 
+        return _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); 
+    }
+    // the unmasked forms trip -Wmaybe-uninitialized in GCC 12's headers, 
+    // a full mask computes the same thing
+    constexpr __mmask8 ALL_PD = 0xFF;
+    constexpr __mmask16 ALL_PS = 0xFFFF;
+    AVX512_INLINE __m512d sub(__m512d a, __m512d b) { return _mm512_mask_sub_round_pd(a, ALL_PD, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __m512 sub(__m512 a, __m512 b) { return _mm512_mask_sub_round_ps(a, ALL_PS, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __m512d add(__m512d a, __m512d b) { return _mm512_mask_add_round_pd(a, ALL_PD, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __m512 add(__m512 a, __m512 b) { return _mm512_mask_add_round_ps(a, ALL_PS, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __m512d mul(__m512d a, __m512d b) { return _mm512_mask_mul_round_pd(a, ALL_PD, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __m512 mul(__m512 a, __m512 b) { return _mm512_mask_mul_round_ps(a, ALL_PS, a, b, ROUND_NEAREST); }
+    AVX512_INLINE __mmask8 lt(__m512d a, __m512d b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    AVX512_INLINE __mmask16 lt(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    AVX512_INLINE __mmask8 eq(__m512d a, __m512d b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    AVX512_INLINE __mmask16 eq(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    AVX512_INLINE __m512d select(__m512d a, __mmask8 mask, __m512d b) { return _mm512_mask_mov_pd(a, mask, b); }
+    AVX512_INLINE __m512 select(__m512 a, __mmask16 mask, __m512 b) { return _mm512_mask_mov_ps(a, mask, b); }
+}
+
+__attribute__((target("avx512f")))
+static bool nearestAVX512(const coord_t* xs, const coord_t* ys, const coord_t* zs, size_t paddedCount, 
+                          const coord_t pt[3], size_t& nearestIdx, coord_t& distSqr) {
+    using namespace avx512;
+    constexpr size_t LANES = 64 / sizeof(coord_t);
+    const auto qx = set1(pt[0]);
+    const auto qy = set1(pt[1]);
+    const auto qz = set1(pt[2]);
+    const auto step = set1(static_cast<coord_t>(LANES));
+    auto idx = iota(coord_t{});
+    auto best = set1(std::numeric_limits<coord_t>::infinity());
+    auto bestIdx = set1(coord_t{});
+    unsigned tied = 0;
+    for (size_t i = 0; i < paddedCount; i += LANES) {
+        auto dx = sub(qx, load(xs + i));
+        auto dy = sub(qy, load(ys + i));
+        auto dz = sub(qz, load(zs + i));
+        auto d = add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz));
+        auto closer = lt(d, best);
+        tied = (tied & ~closer) | eq(d, best);
+        best = select(best, closer, d);
+        bestIdx = select(bestIdx, closer, idx);
+        idx = add(idx, step);
+    }
+    coord_t laneBest[LANES], laneIdx[LANES];
+    store(laneBest, best);
+    store(laneIdx, bestIdx);
+    return reduceLanes(laneBest, laneIdx, tied, nearestIdx, distSqr);
+}
+#endif // x86
+
+// crossovers from bench/BenchNearest over fctraces20 on an AVX-512
+// capable Xeon, rounded down
+static const BruteForceKernel SCALAR_KERNEL{ "scalar", 128, nearestScalar };
+#if defined(__x86_64__) || defined(__i386__)
+static const BruteForceKernel AVX2_KERNEL{ "avx2", 192, nearestAVX2 };
+static const BruteForceKernel AVX512_KERNEL{ "avx512", 640, nearestAVX512 };
+#endif
+
+const std::vector<const BruteForceKernel*>& supportedBruteForceKernels() {
+    static const std::vector<const BruteForceKernel*> kernels = []() {
+        std::vector<const BruteForceKernel*> supported{ &SCALAR_KERNEL };
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) supported.push_back(&AVX2_KERNEL);
+        if (__builtin_cpu_supports("avx512f")) supported.push_back(&AVX512_KERNEL);
+#endif
+        return supported;
+    }();
+    return kernels;
+}
+
+const BruteForceKernel& bruteForceKernel() {
+    return *supportedBruteForceKernels().back();
+}
@@ -0,0 +1,39 @@
+#ifndef BRUTE_FORCE_NN_HPP
+#define BRUTE_FORCE_NN_HPP
+
+#include "Point.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Exhaustive nearest-neighbour search over points stored as separate
+// x, y and z arrays, several points per instruction where the CPU
+// allows it (AVX-512: 8 doubles or 16 floats, AVX2: 4 or 8; on non-x86
+// CPUs only the scalar scan is built). Arrays must hold a multiple of
+// BRUTE_FORCE_PADDING values, one AVX-512 register's worth; the padding
+// slots must be NaN.
+//
+// Distances are summed in the same order as nanoflann's L2_Simple
+// metric, so they are bit-identical to the KD-tree's. The KD-tree
+// breaks exact ties by traversal order, which a scan cannot reproduce,
+// so a tied nearest distance is reported as a failure and the caller
+// falls back to the tree.
+constexpr size_t BRUTE_FORCE_PADDING = 64 / sizeof(coord_t);
+
+struct BruteForceKernel {
+    // instruction set the kernel was compiled for
+    const char* name;
+    // largest point count for which the scan beats a KD-tree query,
+    // measured with bench/BenchNearest
+    size_t maxPoints;
+    // false if the nearest distance is shared by several points
+    bool (*nearest)(const coord_t* xs, const coord_t* ys, const coord_t* zs, size_t paddedCount, 
+                    const coord_t pt[3], size_t& nearestIdx, coord_t& distSqr);
+};
+
+// every kernel the running CPU supports, narrowest first
+const std::vector<const BruteForceKernel*>& supportedBruteForceKernels();
+// the widest of them
+const BruteForceKernel& bruteForceKernel();
+
+#endif // BRUTE_FORCE_NN_HPP
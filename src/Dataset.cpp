@@ -0,0 +1,92 @@
+#include "Dataset.hpp"
+#include "FileIO.hpp"
+#include "NeuronIO.hpp"
+#include "NeuronPack.hpp"
+#include "NeuronIndex.hpp"
+#include "StringUtils.hpp"
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+Dataset::Dataset(const std::string& path, double resampleStep) : path(path), resampleStep(resampleStep) {
+    namespace fs = std::filesystem;
+    if (fs::is_regular_file(path)) {
+        if (resampleStep > 0) {
+            throw std::runtime_error("Cannot resample the packed dataset " + path + ", convert it with --resample instead");
+        }
+        LOG_INFO("Using dataset pack: \"%s\"", path.c_str());
+        pack = std::make_unique<NeuronPack>(path);
+        return;
+    }
+    if (!fs::is_directory(path)) return;
+
+    // the binary and the most direct swc form of every neuron, by rank
+    // of .swc, .swc.gz, .swc.zst
+    struct Forms { std::string binary, swc; int swcRank = 0; };
+    std::unordered_map<std::string, Forms> forms;
+    const char* swcExts[] = { ".swc", SWC_GZIP_EXT, SWC_ZSTD_EXT };
+    for (const auto& filepath : getDatasetFilepaths(path)) {
+        std::string neuronID;
+        if (!neuronIDFromFilepath(filepath, neuronID)) continue;
+        Forms& f = forms[neuronID];
+        if (hasExtension(filepath, NEURON_BINARY_EXT)) {
+            f.binary = filepath;
+            continue;
+        }
+        int rank = 3;
+        while (rank > 0 && !hasExtension(filepath, swcExts[3 - rank])) --rank;
+        if (rank > f.swcRank) {
+            f.swc = filepath;
+            f.swcRank = rank;
+        }
+    }
+
+    size_t stale = 0;
+    neuronFilepaths.reserve(forms.size());
+    for (auto& [neuronID, f] : forms) {
+        // only neurons in both forms cost a stat
+        bool useBinary = !f.binary.empty()
+            && (f.swc.empty() || fs::last_write_time(f.swc) <= fs::last_write_time(f.binary));
+        if (!useBinary && !f.binary.empty()) {
+            LOG_WARN("\"%s\" is newer than \"%s\", loading it instead", f.swc.c_str(), f.binary.c_str());
+            ++stale;
+        }
+        neuronFilepaths.emplace(neuronID, useBinary ? f.binary : f.swc);
+    }
+    if (stale) {
+        std::cerr << path << ": " << stale << " swc files are newer than their binary neurons, loading the swc\n";
+    }
+}
+
+Neuron Dataset::load(const std::string& neuronID) const {
+    Neuron neuron;
+    if (pack) {
+        neuron = pack->load(neuronID);
+    } else {
+        auto it = neuronFilepaths.find(neuronID);
+        // missing, reported as such when opened
+        neuron = loadNeuron(it != neuronFilepaths.end() ? it->second : filenameToPath(path, neuronID, ".swc"),
+                            resampleStep);
+    }
+    // binary records may carry a saved tree, anything else is built here
+    ensureIndex(neuron);
+    return neuron;
+}
+
+StringVector Dataset::listNeuronIDs() const {
+    if (pack) {
+        return pack->getNeuronIDs();
+    }
+    StringVector neuronIDs;
+    neuronIDs.reserve(neuronFilepaths.size());
+    for (const auto& [neuronID, filepath] : neuronFilepaths) {
+        neuronIDs.push_back(neuronID);
+    }
+    std::sort(neuronIDs.begin(), neuronIDs.end());
+    return neuronIDs;
+}
@@ -0,0 +1,51 @@
+#ifndef DATASET_HPP
+#define DATASET_HPP
+
+#include "Neuron.hpp"
+#include "NeuronPack.hpp"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using StringVector = std::vector<std::string>;
+
+// A set of neurons addressed by ID: either a directory of .swc/.nbn
+// files or a single memory-mapped .nbp pack. swc neurons are resampled
+// to resampleStep as they are loaded unless it is 0.
+//
+// A directory is listed once, when the dataset is opened. A neuron loads
+// from its .nbn unless its swc was modified after it, so an edited swc
+// is never shadowed by a stale binary.
+class Dataset {
+    public:
+        explicit Dataset(const std::string& path, double resampleStep = 0.0);
+
+        inline const std::string& getPath() const { return path; }
+        inline bool isPack() const { return pack != nullptr; }
+        inline double getResampleStep() const { return resampleStep; }
+
+        Neuron load(const std::string& neuronID) const;
+        StringVector listNeuronIDs() const;
+    private:
+        std::string path;
+        double resampleStep;
+        std::unique_ptr<NeuronPack> pack;
+        // file each neuron of a directory loads from
+        std::unordered_map<std::string, std::string> neuronFilepaths;
+};
+
+// Hands out loaded neurons by dataset and ID.
+class NeuronSource {
+    public:
+        virtual ~NeuronSource() = default;
+        virtual std::shared_ptr<const Neuron> get(const Dataset& dataset, const std::string& neuronID) = 0;
+        // hint that neuronID will be asked for soon, sources that can load
+        // in the background start doing so
+        virtual void prefetch(const Dataset&, const std::string&) {}
+        virtual void print(std::ostream& out) const = 0;
+};
+
+#endif // DATASET_HPP
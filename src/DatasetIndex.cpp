@@ -0,0 +1,182 @@
+#include "DatasetIndex.hpp"
+#include "NeuronPack.hpp"
+#include "StringUtils.hpp"
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static constexpr char INDEX_MAGIC[4] = { 'N', 'B', 'X', '1' };
+static constexpr uint32_t INDEX_VERSION = 2;
+// bits per axis of a voxel key, voxels are counted from the middle of the range
+static constexpr int VOXEL_BITS = 21;
+static constexpr int64_t VOXEL_LIMIT = (int64_t{1} << VOXEL_BITS) - 1;
+static constexpr int64_t VOXEL_ORIGIN = int64_t{1} << (VOXEL_BITS - 1);
+
+static uint64_t voxelKey(int64_t x, int64_t y, int64_t z) {
+    return static_cast<uint64_t>(x) << (2 * VOXEL_BITS) | static_cast<uint64_t>(y) << VOXEL_BITS
+        | static_cast<uint64_t>(z);
+}
+
+template<typename T>
+static T readAt(const std::vector<char>& data, size_t& pos, const std::string& filepath) {
+    if (pos + sizeof(T) > data.size()) {
+        throw std::runtime_error("Truncated dataset index: " + filepath);
+    }
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+template<typename T>
+static void writeValue(std::ofstream& fout, const T& value) {
+    fout.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+DatasetIndex::DatasetIndex(double voxelSize, double reach, uint64_t matrixFingerprint) 
+    : voxelSize(voxelSize), reach(reach), matrixFingerprint(matrixFingerprint) {
+    if (!(voxelSize > 0) || !std::isfinite(voxelSize)) {
+        throw std::runtime_error("dataset index voxel size must be positive");
+    }
+    if (!(reach >= 0) || reach > voxelSize) {
+        throw std::runtime_error("dataset index reach must be between 0 and the voxel size");
+    }
+}
+
+std::string DatasetIndex::pathFor(const std::string& datasetPath) {
+    // beside a pack, inside a directory
+    if (hasExtension(datasetPath, NEURON_PACK_EXT)) {
+        return datasetPath.substr(0, datasetPath.size() - std::strlen(NEURON_PACK_EXT)) + DATASET_INDEX_EXT;
+    }
+    return (std::filesystem::path(datasetPath) / (std::string("dataset") + DATASET_INDEX_EXT)).string();
+}
+
+std::vector<uint64_t> DatasetIndex::voxelKeys(const PointVector& midpoints) const {
+    std::vector<uint64_t> keys;
+    keys.reserve(midpoints.size());
+    auto cell = [this](double c) {
+        // clamped at the edges of the grid, which only ever adds candidates
+        double v = std::floor(c / voxelSize) + VOXEL_ORIGIN;
+        return static_cast<int64_t>(std::clamp(v, 0.0, static_cast<double>(VOXEL_LIMIT)));
+    };
+    for (const auto& p : midpoints) {
+        keys.push_back(voxelKey(cell(p.x), cell(p.y), cell(p.z)));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+void DatasetIndex::add(const std::string& neuronID, const Neuron& neuron) {
+    uint32_t id = neuronIDs.size();
+    neuronIDs.push_back(neuronID);
+    for (uint64_t key : voxelKeys(neuron.midpoints)) {
+        postings.emplace_back(key, id);
+    }
+}
+
+void DatasetIndex::finish() {
+    std::sort(postings.begin(), postings.end());
+}
+
+std::vector<std::string> DatasetIndex::overlapping(const Neuron& query) const {
+    // the voxels around each of the query's, each looked up once
+    std::vector<uint64_t> around;
+    for (uint64_t key : voxelKeys(query.midpoints)) {
+        const int64_t x = key >> (2 * VOXEL_BITS), y = (key >> VOXEL_BITS) & VOXEL_LIMIT, z = key & VOXEL_LIMIT;
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+            for (int64_t dy = -1; dy <= 1; ++dy) {
+                for (int64_t dz = -1; dz <= 1; ++dz) {
+                    int64_t nx = x + dx, ny = y + dy, nz = z + dz;
+                    if (nx < 0 || ny < 0 || nz < 0 || nx > VOXEL_LIMIT || ny > VOXEL_LIMIT || nz > VOXEL_LIMIT) continue;
+                    around.push_back(voxelKey(nx, ny, nz));
+                }
+            }
+        }
+    }
+    std::sort(around.begin(), around.end());
+    around.erase(std::unique(around.begin(), around.end()), around.end());
+
+    std::vector<bool> hit(neuronIDs.size());
+    auto it = postings.begin();
+    for (uint64_t key : around) {
+        // both sorted, so each search starts where the last one ended
+        it = std::lower_bound(it, postings.end(), std::make_pair(key, uint32_t{0}));
+        for (; it != postings.end() && it->first == key; ++it) hit[it->second] = true;
+    }
+    std::vector<std::string> candidates;
+    for (size_t i = 0; i < neuronIDs.size(); ++i) {
+        if (hit[i]) candidates.push_back(neuronIDs[i]);
+    }
+    return candidates;
+}
+
+void DatasetIndex::write(const std::string& filepath) const {
+    std::ofstream fout(filepath, std::ios::binary | std::ios::trunc);
+    if (!fout) { throw std::runtime_error("Cannot open " + filepath); }
+    fout.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    writeValue(fout, INDEX_VERSION);
+    writeValue(fout, voxelSize);
+    writeValue(fout, reach);
+    writeValue(fout, matrixFingerprint);
+    writeValue(fout, static_cast<uint64_t>(neuronIDs.size()));
+    for (const auto& neuronID : neuronIDs) {
+        writeValue(fout, static_cast<uint32_t>(neuronID.size()));
+        fout.write(neuronID.data(), neuronID.size());
+    }
+    writeValue(fout, static_cast<uint64_t>(postings.size()));
+    for (const auto& [key, id] : postings) {
+        writeValue(fout, key);
+        writeValue(fout, id);
+    }
+    if (!fout) { throw std::runtime_error("Failed writing " + filepath); }
+}
+
+DatasetIndex DatasetIndex::read(const std::string& filepath) {
+    std::ifstream fin(filepath, std::ios::binary);
+    if (!fin) { throw std::runtime_error("Cannot open " + filepath); }
+    std::vector<char> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(INDEX_MAGIC) || std::memcmp(data.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        throw std::runtime_error("Not a dataset index: " + filepath);
+    }
+    size_t pos = sizeof(INDEX_MAGIC);
+    if (readAt<uint32_t>(data, pos, filepath) != INDEX_VERSION) {
+        throw std::runtime_error("Unsupported dataset index version in " + filepath + ", convert the dataset again");
+    }
+    double voxelSize = readAt<double>(data, pos, filepath);
+    double reach = readAt<double>(data, pos, filepath);
+    DatasetIndex index(voxelSize, reach, readAt<uint64_t>(data, pos, filepath));
+    uint64_t count = readAt<uint64_t>(data, pos, filepath);
+    for (uint64_t i = 0; i < count; ++i) {
+        uint32_t idLength = readAt<uint32_t>(data, pos, filepath);
+        if (pos + idLength > data.size()) {
+            throw std::runtime_error("Truncated dataset index: " + filepath);
+        }
+        index.neuronIDs.emplace_back(data.data() + pos, idLength);
+        pos += idLength;
+    }
+    uint64_t numPostings = readAt<uint64_t>(data, pos, filepath);
+    if ((data.size() - pos) / (sizeof(uint64_t) + sizeof(uint32_t)) < numPostings) {
+        throw std::runtime_error("Truncated dataset index: " + filepath);
+    }
+    index.postings.reserve(numPostings);
+    for (uint64_t i = 0; i < numPostings; ++i) {
+        uint64_t key = readAt<uint64_t>(data, pos, filepath);
+        uint32_t id = readAt<uint32_t>(data, pos, filepath);
+        if (id >= count) {
+            throw std::runtime_error("Corrupt dataset index: " + filepath);
+        }
+        index.postings.emplace_back(key, id);
+    }
+    LOG_DEBUG("read dataset index \"%s\": %zu neurons, %zu postings", filepath.c_str(),
+              index.neuronIDs.size(), index.postings.size());
+    return index;
+}
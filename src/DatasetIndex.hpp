@@ -0,0 +1,68 @@
+#ifndef DATASET_INDEX_HPP
+#define DATASET_INDEX_HPP
+
+#include "Neuron.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr const char *DATASET_INDEX_EXT = ".nbx";
+
+// Dataset spatial index (.nbx) layout, host byte order:
+//   char[4]  magic "NBX1"
+//   uint32   version
+//   double   voxel edge length
+//   double   match distance the index was built for, see getReach()
+//   uint64   Matrix::fingerprint() of the matrix it was built for
+//   uint64   number of neurons n
+//   n entries of:
+//     uint32  id length
+//     char[]  neuron id
+//   uint64   number of postings m
+//   m postings, sorted, of:
+//     uint64  voxel key
+//     uint32  neuron, by position in the ids above
+//
+// An inverted list from the voxels of a fixed grid to the neurons with a
+// segment midpoint in them. overlapping() looks up the 27 voxels around
+// every midpoint of a query, so it returns every neuron that comes
+// within one voxel edge of the query, and none that stays more than
+// 2 * sqrt(3) edges away from it.
+class DatasetIndex {
+    public:
+        // empty index over a grid of voxelSize edges, filled by add(),
+        // built for matches within reach under the matrix fingerprinted
+        explicit DatasetIndex(double voxelSize, double reach = 0, uint64_t matrixFingerprint = 0);
+        // reads an index written by write()
+        static DatasetIndex read(const std::string& filepath);
+        // where the index of a dataset directory or pack is kept
+        static std::string pathFor(const std::string& datasetPath);
+
+        void add(const std::string& neuronID, const Neuron& neuron);
+        // sorts the postings, after the last add()
+        void finish();
+        void write(const std::string& filepath) const;
+
+        // ids of the neurons overlapping query, in the order they were added
+        std::vector<std::string> overlapping(const Neuron& query) const;
+        inline double getVoxelSize() const { return voxelSize; }
+        // no target left out has a segment within this distance of the query
+        inline double getReach() const { return reach; }
+        inline uint64_t getMatrixFingerprint() const { return matrixFingerprint; }
+        inline size_t size() const { return neuronIDs.size(); }
+    private:
+        double voxelSize;
+        double reach;
+        uint64_t matrixFingerprint;
+        std::vector<std::string> neuronIDs;
+        // (voxel key, neuron), sorted once finished
+        std::vector<std::pair<uint64_t, uint32_t>> postings;
+
+        // keys of the voxels holding the midpoints, sorted and unique
+        std::vector<uint64_t> voxelKeys(const PointVector& midpoints) const;
+};
+
+#endif // DATASET_INDEX_HPP
@@ -6,12 +6,24 @@
 constexpr const char *USAGE_MSG = 
 "USAGE: ./nblast++ ... followed by one of the following:\n"
 "    -q queryFile targetFile1 [targetFile2 ...]     # pair the query against all listed targets, produces .score files |\n"
+"    -q matrixFile -i query,target -k K id [id ...] # the K best-scoring targets of each listed query, best first |\n"
+"    -q matrixFile -i query,target -x id [id ...]   # score each listed query against the targets near it in the target's spatial index |\n"
 "    -g swcFile1 [swcFile2 ...]                     # generate a p-value matrix for the swc files, prints a .matrix file to stdout |\n"
+"    -b matrixFile -i swcDir,binaryDir              # convert swc files to binary .nbn neurons, self-scored under matrixFile |\n"
+"    -b matrixFile -i swcDir,dataset.nbp            # convert swc files into a single memory-mapped dataset pack |\n"
+"                                                   # (both also write the dataset's spatial index, .nbx)\n"
+"    -a matrixFile -i dataset,dataset [id ...]      # score every pair of the dataset's (or the listed) neurons, prints the symmetric score matrix |\n"
+"    -z step,fraction                               # with -a, rank pairs on neurons coarsened to one segment per step voxel, rescore the best fraction exactly, write NA for the rest\n"
+"    --resample STEP                                # redraw swc skeletons with points STEP apart as they are loaded\n"
+"    -f                                             # with -q or -a, approximate scores: stop match searches at the matrix's last distance edge, matches beyond score its last row's mean\n"
+"    -p                                             # load both datasets into memory in parallel before querying/generating\n"
+"    -t N                                           # worker threads for loading and scoring (default: one per hardware thread)\n"
 "    -n N swcFile2 [swcFile2 ...]                   # produce random pairs, ad infinitum if number of random pairs == -1, prints a .sin file to stdout |\n"
 "    -s sinFile                                     # turn a sin file into a p-value matrix, produces a .matrix file |\n"
 "    -r randomPairMatrixFile                        # read in the random pair matrix file\n"
 "    -m matchPairMatrixFile                         # read in the match pair matrix file\n"
-"    -c                                             # Calculate cosine angle measure instead of sine\n"
+"    -c cacheMiB                                    # memory cap for parsed neurons cached in query mode (default 1024)\n"
+"    -l N                                           # query pairs read ahead from stdin and loaded in the background (default 16, 0 = off)\n"
 "    -h                                             # print usage message\n";
 constexpr const char *INVALID_COMB_ERR_MSG = "invalid option combination: -%s and -%s\n";
 constexpr const char *REQ_ARG_ERR_MSG = "option -%c requires an argument\n";
@@ -5,51 +5,312 @@
 #include "Matrix.hpp"
 #include "StringUtils.hpp"
 #include "Logging.hpp"
+#include "NeuronIO.hpp"
 
 #include <fstream>
 #include <filesystem>
 #include <string>
 #include <limits>
 #include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 
-uint64_t computeLineCount(std::ifstream& fin) {
-    fin.seekg(0, std::ios::beg);
-    const size_t bufferSize = 1 << 20;
-    std::vector<char> buffer(bufferSize);
-    unsigned lineCount = 0;
-    while (fin) {
-        fin.read(buffer.data(), buffer.size());
-        std::streamsize bytes_read = fin.gcount();
-        for (std::streamsize i = 0; i < bytes_read; ++i) {
-            if (buffer[i] == '\n') ++lineCount;
+#include <zlib.h>
+#ifdef NBLAST_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// ================= SWC Parsing =================
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline const char* skipBlanks(const char* ptr, const char* end) {
+    while (ptr < end && isBlank(*ptr)) ++ptr;
+    return ptr;
+}
+
+static inline const char* skipToken(const char* ptr, const char* end) {
+    ptr = skipBlanks(ptr, end);
+    while (ptr < end && !isBlank(*ptr) && *ptr != '\n') ++ptr;
+    return ptr;
+}
+
+// parses the next whitespace separated field of a line into value,
+// returns nullptr if the field is missing or malformed
+template<typename T>
+static inline const char* parseField(const char* ptr, const char* end, T& value) {
+    ptr = skipBlanks(ptr, end);
+    if (ptr < end && *ptr == '+') ++ptr;
+    auto [next, ec] = std::from_chars(ptr, end, value);
+    if (ec != std::errc() || next == ptr) return nullptr;
+    return next;
+}
+
+[[noreturn]] static void malformedLine(const std::string& source, size_t lineNumber) {
+    throw std::runtime_error("Malformed swc line " + std::to_string(lineNumber) + " in " + source);
+}
+
+// Maps swc ids to positions in pts. Dense id ranges use a flat table,
+// anything sparser falls back to a hash map.
+class IDIndex {
+    public:
+        IDIndex(const PointVector& pts, const std::string& source) {
+            int minID = std::numeric_limits<int>::max(), maxID = std::numeric_limits<int>::min();
+            for (const auto& p : pts) {
+                minID = std::min(minID, p.id);
+                maxID = std::max(maxID, p.id);
+            }
+            offset = minID;
+            bool dense = !pts.empty() && static_cast<int64_t>(maxID) - minID < 2 * static_cast<int64_t>(pts.size()) + 16;
+            if (dense) table.assign(maxID - minID + 1, -1);
+            for (size_t i = 0; i < pts.size(); ++i) {
+                bool inserted;
+                if (dense) {
+                    int& slot = table[pts[i].id - offset];
+                    inserted = slot == -1;
+                    slot = i;
+                } else {
+                    inserted = map.emplace(pts[i].id, i).second;
+                }
+                if (!inserted) {
+                    throw std::runtime_error("Duplicate swc id " + std::to_string(pts[i].id) + " in " + source);
+                }
+            }
+        }
+        // position of id, -1 if absent
+        int find(int id) const {
+            if (!table.empty()) {
+                int64_t slot = static_cast<int64_t>(id) - offset;
+                return slot >= 0 && slot < static_cast<int64_t>(table.size()) ? table[slot] : -1;
+            }
+            auto it = map.find(id);
+            return it == map.end() ? -1 : it->second;
         }
+    private:
+        int offset = 0;
+        std::vector<int> table;
+        std::unordered_map<int, int> map;
+};
+
+// Reorders points read in file order into a dense 0..n-1 array in which
+// every parent precedes its children, and rewrites each parent field
+// from an swc id to an index into that array. Files that are already
+// topologically ordered keep their order.
+static PointVector compactTopology(PointVector pts, const std::string& source) {
+    const size_t n = pts.size();
+    IDIndex ids(pts, source);
+
+    std::vector<int> parentIndex(n);
+    bool ordered = true;
+    for (size_t i = 0; i < n; ++i) {
+        if (pts[i].parent < 0) {
+            parentIndex[i] = POINT_DEFAULT_PARENT;
+            continue;
+        }
+        int parent = ids.find(pts[i].parent);
+        if (parent == -1) {
+            throw std::runtime_error("Unknown parent id " + std::to_string(pts[i].parent) 
+                + " of swc id " + std::to_string(pts[i].id) + " in " + source);
+        }
+        parentIndex[i] = parent;
+        if (static_cast<size_t>(parent) >= i) ordered = false;
     }
-    fin.clear();
-    fin.seekg(0, std::ios::beg);
-    return lineCount + 1;
+    if (ordered) {
+        for (size_t i = 0; i < n; ++i) pts[i].parent = parentIndex[i];
+        return pts;
+    }
+
+    // children of each point, in file order
+    std::vector<int> childStart(n + 1, 0);
+    std::vector<int> children(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (parentIndex[i] != POINT_DEFAULT_PARENT) ++childStart[parentIndex[i] + 1];
+    }
+    for (size_t i = 0; i < n; ++i) childStart[i + 1] += childStart[i];
+    std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        if (parentIndex[i] != POINT_DEFAULT_PARENT) children[fill[parentIndex[i]]++] = i;
+    }
+
+    // depth-first preorder from each root
+    std::vector<int> newIndex(n, -1);
+    PointVector out;
+    out.reserve(n);
+    std::vector<int> stack;
+    for (size_t root = 0; root < n; ++root) {
+        if (parentIndex[root] != POINT_DEFAULT_PARENT) continue;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int v = stack.back();
+            stack.pop_back();
+            newIndex[v] = out.size();
+            const Point& p = pts[v];
+            int parent = parentIndex[v] == POINT_DEFAULT_PARENT ? POINT_DEFAULT_PARENT : newIndex[parentIndex[v]];
+            out.emplace_back(p.id, p.x, p.y, p.z, parent);
+            for (int c = childStart[v + 1] - 1; c >= childStart[v]; --c) {
+                stack.push_back(children[c]);
+            }
+        }
+    }
+    if (out.size() != n) {
+        throw std::runtime_error("Cycle in swc parent links in " + source);
+    }
+    return out;
+}
+
+// Parses the complete lines in [ptr, end) into vec and returns the
+// start of the trailing partial line. With final set the input is known
+// to end at end, so a last line without a newline is parsed as well.
+static const char* parseLines(const char* ptr, const char* end, bool final, 
+                              PointVector& vec, size_t& lineNumber, const std::string& source) {
+    while (ptr < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(ptr, '\n', end - ptr));
+        if (!lineEnd) {
+            if (!final) return ptr;
+            lineEnd = end;
+        }
+        ++lineNumber;
+        ptr = skipBlanks(ptr, lineEnd);
+        if (ptr == lineEnd || *ptr == '#') {
+            ptr = lineEnd + 1;
+            continue;
+        }
+
+        // id label x y z radius parent
+        Point p;
+        ptr = parseField(ptr, lineEnd, p.id);
+        if (!ptr) malformedLine(source, lineNumber);
+        ptr = skipToken(ptr, lineEnd);
+        if (!(ptr = parseField(ptr, lineEnd, p.x))) malformedLine(source, lineNumber);
+        if (!(ptr = parseField(ptr, lineEnd, p.y))) malformedLine(source, lineNumber);
+        if (!(ptr = parseField(ptr, lineEnd, p.z))) malformedLine(source, lineNumber);
+        ptr = skipToken(ptr, lineEnd);
+        if (!(ptr = parseField(ptr, lineEnd, p.parent))) malformedLine(source, lineNumber);
+
+        vec.push_back(p);
+        ptr = lineEnd + 1;
+    }
+    return end;
+}
+
+PointVector parsePoints(const char* data, size_t size, const std::string& source) {
+    PointVector vec;
+    // ~50 bytes per swc line
+    vec.reserve(size / 40 + 1);
+    size_t lineNumber = 0;
+    parseLines(data, data + size, true, vec, lineNumber, source);
+    return compactTopology(std::move(vec), source);
+}
+
+// Parses swc text produced chunk by chunk by readChunk(out, capacity),
+// which returns the number of bytes written and 0 at the end of input.
+// Only a chunk and the partial line carried over from the previous one
+// are held in memory at a time.
+template<typename ReadChunk>
+static PointVector parseStream(ReadChunk readChunk, const std::string& source) {
+    constexpr size_t CHUNK_SIZE = 1 << 16;
+    static thread_local std::string buffer;
+    PointVector vec;
+    size_t lineNumber = 0;
+    size_t carry = 0;
+    for (;;) {
+        buffer.resize(carry + CHUNK_SIZE);
+        size_t n = readChunk(buffer.data() + carry, CHUNK_SIZE);
+        const char* end = buffer.data() + carry + n;
+        const char* rest = parseLines(buffer.data(), end, n == 0, vec, lineNumber, source);
+        if (n == 0) break;
+        carry = end - rest;
+        std::memmove(buffer.data(), rest, carry);
+    }
+    return compactTopology(std::move(vec), source);
 }
 
+static PointVector loadGzipPoints(const std::string& filepath) {
+    std::unique_ptr<gzFile_s, int (*)(gzFile)> file(gzopen(filepath.c_str(), "rb"), gzclose);
+    if (!file) { throw std::runtime_error("Cannot open " + filepath); }
+    gzbuffer(file.get(), 1 << 17);
+    return parseStream([&](char* out, size_t capacity) -> size_t {
+        int n = gzread(file.get(), out, static_cast<unsigned>(capacity));
+        if (n < 0) {
+            int err;
+            throw std::runtime_error("Cannot read " + filepath + ": " + gzerror(file.get(), &err));
+        }
+        return n;
+    }, filepath);
+}
+
+#ifdef NBLAST_HAVE_ZSTD
+static PointVector loadZstdPoints(const std::string& filepath) {
+    std::ifstream fin{filepath, std::ios::binary};
+    if (!fin) { throw std::runtime_error("Cannot open " + filepath); }
+    std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    std::vector<char> compressed(ZSTD_DStreamInSize());
+    ZSTD_inBuffer input{ compressed.data(), 0, 0 };
+    bool eof = false;
+    // 0 once a frame is fully decoded and flushed
+    size_t pending = 0;
+    return parseStream([&](char* out, size_t capacity) -> size_t {
+        ZSTD_outBuffer output{ out, capacity, 0 };
+        while (output.pos == 0) {
+            if (input.pos == input.size && !eof) {
+                fin.read(compressed.data(), compressed.size());
+                input.size = fin.gcount();
+                input.pos = 0;
+                eof = input.size == 0;
+            }
+            if (eof && pending == 0) return 0;
+            pending = ZSTD_decompressStream(dctx.get(), &output, &input);
+            if (ZSTD_isError(pending)) {
+                throw std::runtime_error("Cannot read " + filepath + ": " + ZSTD_getErrorName(pending));
+            }
+            if (eof && output.pos == 0) {
+                throw std::runtime_error("Cannot read " + filepath + ": truncated zstd stream");
+            }
+        }
+        return output.pos;
+    }, filepath);
+}
+#else
+static PointVector loadZstdPoints(const std::string& filepath) {
+    throw std::runtime_error("Cannot read " + filepath + ": built without zstd support (make ZSTD=1)");
+}
+#endif
+
 PointVector loadPoints(const std::string& filepath) {
-    std::ifstream fin{filepath};
+    if (hasExtension(filepath, SWC_GZIP_EXT)) {
+        return loadGzipPoints(filepath);
+    } else if (hasExtension(filepath, SWC_ZSTD_EXT)) {
+        return loadZstdPoints(filepath);
+    }
+    std::ifstream fin{filepath, std::ios::binary | std::ios::ate};
     if (!fin) { throw std::runtime_error("Cannot open " + filepath); }
-    PointVector vec;
-    int pointCount = computeLineCount(fin);
-    LOG_DEBUG("pointCount: %d", pointCount);
-    vec.resize(pointCount);
+    // reused across files so steady-state loading does not allocate
+    static thread_local std::string buffer;
+    buffer.resize(fin.tellg());
+    fin.seekg(0, std::ios::beg);
+    fin.read(buffer.data(), buffer.size());
+    if (!fin) { throw std::runtime_error("Cannot read " + filepath); }
+    return parsePoints(buffer.data(), buffer.size(), filepath);
+}
 
-    std::string line;
-    size_t id = -1;
-    while (std::getline(fin, line)) {
-        if (line.empty()) continue;
-        if (!line.empty() && line[0] == '#') continue;
-        std::istringstream sin(line);
-        sin >> id;
-        Point p;
-        p.parse(line);
-        vec[id] = p;
+// path of a neuron in a dataset directory, preferring its binary form,
+// then plain swc, then compressed swc
+bool neuronIDFromFilepath(const std::string& filepath, std::string& neuronID) {
+    for (const char* ext : { NEURON_BINARY_EXT, ".swc", SWC_GZIP_EXT, SWC_ZSTD_EXT }) {
+        if (!hasExtension(filepath, ext)) continue;
+        std::string filename;
+        basename(filepath, filename);
+        neuronID = filename.substr(0, filename.size() - std::strlen(ext));
+        return true;
     }
-    fin.close();
-    return vec;
+    return false;
 }
 
 void ensureDirectory(const std::string& filepath) {
@@ -70,7 +331,7 @@ StringVector getDatasetFilepaths(const std::string& filepath) {
     return pathVector;
 }
 
-StringVectorPair getKnownMatchesFilepaths(const Args& a) {
+StringVectorPair getKnownMatchesIDs(const Args& a) {
     StringVectorPair vecPair;
     std::ifstream fin{a.knownMatchesFilepath, std::ios::in};
     if (!fin) { throw std::runtime_error("Cannot open " + a.knownMatchesFilepath); }
@@ -82,8 +343,8 @@ StringVectorPair getKnownMatchesFilepaths(const Args& a) {
         sin.str(line);
         sin >> query >> target;
         if (sin.fail()) throw std::runtime_error("Malformed line in " + a.knownMatchesFilepath + ": " + line);
-        vecPair.first.push_back(filenameToPath(a.queryDatasetFilepath, query, ".swc"));
-        vecPair.second.push_back(filenameToPath(a.queryDatasetFilepath, target, ".swc"));
+        vecPair.first.push_back(query);
+        vecPair.second.push_back(target);
         sin.str("");
     }
     return vecPair;
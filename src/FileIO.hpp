@@ -7,7 +7,18 @@
 #include <vector>
 #include <string>
 
+// compressed swc, decoded while parsing
+constexpr const char* SWC_GZIP_EXT = ".swc.gz";
+// needs a build with ZSTD=1
+constexpr const char* SWC_ZSTD_EXT = ".swc.zst";
+
+// Points come back dense and topologically ordered: point i keeps its
+// swc id in Point::id, and Point::parent is the index of its parent in
+// the returned vector (-1 for roots).
+PointVector parsePoints(const char* data, size_t size, const std::string& source);
 PointVector loadPoints(const std::string& filepath);
+// false if filepath is not a neuron file
+bool neuronIDFromFilepath(const std::string& filepath, std::string& neuronID);
 
 void ensureDirectory(const std::string& path);
 
@@ -15,6 +26,6 @@ using StringVector = std::vector<std::string>;
 StringVector getDatasetFilepaths(const std::string& filepath);
 
 using StringVectorPair = std::pair<std::vector<std::string>, std::vector<std::string>>;
-StringVectorPair getKnownMatchesFilepaths(const Args& a);
+StringVectorPair getKnownMatchesIDs(const Args& a);
 
 #endif // FILEIO_HPP
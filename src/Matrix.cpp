@@ -5,47 +5,113 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+Matrix::Matrix(const DoubleVector& distanceBins, const DoubleVector& angleBins) 
+    : Matrix(distanceBins, angleBins, DoubleVector(distanceBins.size() * angleBins.size(), 0.0)) {}
+
+Matrix::Matrix(const DoubleVector& distanceBins, const DoubleVector& angleBins, const DoubleVector& table) 
+    : distanceBins(distanceBins), angleBins(angleBins), table(table) {
+    if (distanceBins.empty() || angleBins.empty()) {
+        throw std::runtime_error("matrix needs at least one distance and one angle bin");
+    } else if (table.size() != distanceBins.size() * angleBins.size()) {
+        throw std::runtime_error("matrix table does not match its bins");
+    } else if (!std::is_sorted(distanceBins.begin(), distanceBins.end()) || 
+               !std::is_sorted(angleBins.begin(), angleBins.end())) {
+        throw std::runtime_error("matrix bins must be in ascending order");
+    }
+    buildLookup();
+}
+
+void Matrix::buildLookup() {
+    distanceEdges.assign(distanceBins.begin(), distanceBins.end() - 1);
+
+    angleEdges.clear();
+    angleEdges.push_back(-std::numeric_limits<double>::infinity());
+    angleEdges.insert(angleEdges.end(), angleBins.begin(), angleBins.end() - 1);
+    angleEdges.push_back(std::numeric_limits<double>::infinity());
+
+    // evenly spaced edges step, 2 * step, ... (the 0.1 steps of
+    // ANGLE_BINS) are found by dividing; findAngleBin() corrects the
+    // rounding, so they only need to be close
+    double step = angleBins[0];
+    angleStepInverse = step > 0 ? 1 / step : 0;
+    for (size_t i = 0; i < angleBins.size() && angleStepInverse != 0; ++i) {
+        if (std::abs(angleBins[i] - (i + 1) * step) > 1e-6 * step) angleStepInverse = 0;
+    }
+
+    specialize();
+}
 
 void Matrix::increment(double distance, double angle, double value) {
-    int row = findDistanceBin(distance);
-    int col = findAngleBin(angle);
-    LOG_DEBUG("row: %d column: %d", row, col);
+    fixed = std::monostate{};
+    size_t row = findDistanceBin(distance);
+    size_t col = findAngleBin(angle);
+    LOG_DEBUG("row: %zu column: %zu", row, col);
     LOG_DEBUG("value: %f", value);
-    LOG_DEBUG("result: %f", value + table[row][col]);
-    table[row][col] += value;
+    LOG_DEBUG("result: %f", value + at(row, col));
+    at(row, col) += value;
 }
 Matrix& Matrix::prefixSum() {
-    for (size_t i = 0; i < table.size(); ++i) {
+    fixed = std::monostate{};
+    for (size_t i = 0; i < rows(); ++i) {
         int tmp = 0, row_counter = 0;
-        for (size_t j = 0; j < table[i].size(); ++j) {
-            tmp = table[i][j];
-            table[i][j] += row_counter;
+        for (size_t j = 0; j < cols(); ++j) {
+            tmp = at(i, j);
+            at(i, j) += row_counter;
             row_counter += tmp;
             if (i > 0) {
-                table[i][j] += table[i - 1][j];
+                at(i, j) += at(i - 1, j);
             }
         }
     }
     return *this;
 }
 Matrix& Matrix::toECDF() {
-    if (table.empty() || table[0].empty()) throw std::runtime_error("cannot convert to ECDF: matrix empty/invalid");
+    if (table.empty()) throw std::runtime_error("cannot convert to ECDF: matrix empty/invalid");
 
-    double total = table.back().back();
+    double total = table.back();
     if (total == 0.0) throw std::runtime_error("cannot convert to ECDF: total sum of matrix is zero");
 
-    for (size_t i = 0; i < table.size(); ++i) {
-        for (size_t j = 0; j < table[i].size(); ++j) {
-            table[i][j] /= total;
-        }
+    fixed = std::monostate{};
+    for (auto& value : table) {
+        value /= total;
     }
     return *this;
 }
-
-double Matrix::score(double distance, double angle) const {
-    int row = findDistanceBin(distance);
-    int col = findAngleBin(angle);
-    return table.at(row).at(col);
+double Matrix::farScore() const {
+    double sum = 0;
+    for (size_t j = 0; j < cols(); ++j) sum += at(rows() - 1, j);
+    return sum / cols();
+}
+bool Matrix::lastRowIsConstant() const {
+    if (table.empty()) return false;
+    for (size_t j = 1; j < cols(); ++j) {
+        if (at(rows() - 1, j) != at(rows() - 1, 0)) return false;
+    }
+    return true;
+}
+// FNV-1a over the bin edges and table, identifies the matrix a
+// precomputed value (e.g. a stored self-score) was derived from
+uint64_t Matrix::fingerprint() const {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const DoubleVector& values) {
+        for (double v : values) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+            for (size_t i = 0; i < sizeof(double); ++i) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        }
+    };
+    mix(distanceBins);
+    mix(angleBins);
+    // row-major, so the same bytes in the same order as row by row
+    mix(table);
+    return hash;
 }
 std::ostream& operator<<(std::ostream& out, const Matrix& mat) {
     constexpr int precision = 4;
@@ -63,14 +129,14 @@ std::ostream& operator<<(std::ostream& out, const Matrix& mat) {
     }
     out << "\n";
 
-    for (size_t j = 0; j < mat.table.size(); ++j) {
+    for (size_t j = 0; j < mat.rows(); ++j) {
         out << std::fixed << std::setprecision(0);
         out << mat.distanceBins[j] << "\t";
         out << std::fixed << std::setprecision(precision);
 
-        for (size_t k = 0; k < mat.table[j].size(); ++k) {
-            out << mat.table[j][k];
-            if (k + 1 < mat.table[j].size())
+        for (size_t k = 0; k < mat.cols(); ++k) {
+            out << mat.at(j, k);
+            if (k + 1 < mat.cols())
                 out << "\t";
         }
         out << "\n";
@@ -80,17 +146,3 @@ std::ostream& operator<<(std::ostream& out, const Matrix& mat) {
 
     return out;
 }
-
-
-int Matrix::findDistanceBin(double value) const {
-    for (size_t i = 0; i < distanceBins.size(); ++i){
-        if (value <= distanceBins[i]) return i;
-    }
-    return distanceBins.size() - 1;
-}
-int Matrix::findAngleBin(double value) const {
-    for (size_t i = 0; i < angleBins.size(); ++i){
-        if (value <= angleBins[i]) return i;
-    }
-    return angleBins.size() - 1;
-}
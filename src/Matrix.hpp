@@ -4,6 +4,12 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <variant>
 
 // defaults for banc-fafb
 static constexpr unsigned int NUM_DISTANCE_BINS = 7;
@@ -30,37 +36,229 @@ static constexpr std::array<double, NUM_ANGLE_BINS> ANGLE_BINS{
     1
 };
 
+// smat.fcwb, the FlyCircuit matrix shipped with the original NBLAST
+static constexpr unsigned int FCWB_NUM_DISTANCE_BINS = 21;
+static constexpr std::array<double, FCWB_NUM_DISTANCE_BINS> FCWB_DISTANCE_BINS{ 
+    0.75, 1.5, 2, 2.5, 3, 3.5, 4, 5, 6, 7, 8, 9, 10, 12, 14, 16, 20, 25, 30, 40, 500
+};
+
 using DoubleVector = std::vector<double>;
 using DoubleVector2D = std::vector<DoubleVector>;
 
+// Bin edges of a layout known at compile time, one specialization per
+// layout a FixedMatrix exists for.
+template<size_t D, size_t A>
+struct MatrixLayout;
+
+template<>
+struct MatrixLayout<NUM_DISTANCE_BINS, NUM_ANGLE_BINS> {
+    static constexpr const auto& distanceBins = DISTANCE_BINS;
+    static constexpr const auto& angleBins = ANGLE_BINS;
+};
+
+template<>
+struct MatrixLayout<FCWB_NUM_DISTANCE_BINS, NUM_ANGLE_BINS> {
+    static constexpr const auto& distanceBins = FCWB_DISTANCE_BINS;
+    static constexpr const auto& angleBins = ANGLE_BINS;
+};
+
+// Read-only copy of a Matrix whose bins are a known layout. The edges
+// and bin counts are compile-time constants, so bin selection unrolls
+// completely, and the table is a std::array.
+template<size_t D, size_t A>
+class FixedMatrix {
+    public:
+        using Layout = MatrixLayout<D, A>;
+
+        // table holds D rows of A values
+        explicit FixedMatrix(const DoubleVector& table) {
+            std::copy(table.begin(), table.end(), this->table.begin());
+        }
+        // true if the bins are exactly this layout's
+        static bool matches(const DoubleVector& distanceBins, const DoubleVector& angleBins) {
+            return std::equal(distanceBins.begin(), distanceBins.end(), 
+                              Layout::distanceBins.begin(), Layout::distanceBins.end())
+                && std::equal(angleBins.begin(), angleBins.end(), 
+                              Layout::angleBins.begin(), Layout::angleBins.end());
+        }
+        inline double score(double distance, double angle) const {
+            return table[distanceBin(distance) * A + angleBin(angle)];
+        }
+    private:
+        std::array<double, D * A> table;
+
+        static constexpr double INF = std::numeric_limits<double>::infinity();
+        // angle edges between -inf and +inf sentinels, the last one open
+        static constexpr std::array<double, A + 1> angleEdges = [] {
+            std::array<double, A + 1> edges{};
+            edges[0] = -INF;
+            for (size_t i = 0; i + 1 < A; ++i) edges[i + 1] = Layout::angleBins[i];
+            edges[A] = INF;
+            return edges;
+        }();
+        // angle edges at step, 2 * step, ... within rounding
+        static constexpr bool evenAngles = [] {
+            double step = Layout::angleBins[0];
+            for (size_t i = 0; i < A; ++i) {
+                double error = Layout::angleBins[i] - (i + 1) * step;
+                if (error > 1e-6 * step || error < -1e-6 * step) return false;
+            }
+            return step > 0;
+        }();
+
+        // bin of value among edges, the last bin when none holds it: a
+        // branch-free lower bound whose trip count is a constant
+        template<size_t N>
+        static inline size_t lowerBound(const std::array<double, N>& edges, double value) {
+            if constexpr (N == 1) {
+                return 0;
+            } else {
+                size_t base = 0;
+                for (size_t n = N - 1; n > 1; n -= n / 2) {
+                    base = edges[base + n / 2] < value ? base + n / 2 : base;
+                }
+                return base + (edges[base] < value);
+            }
+        }
+        static inline size_t distanceBin(double value) {
+            return lowerBound(Layout::distanceBins, value);
+        }
+        static inline size_t angleBin(double value) {
+            if constexpr (evenAngles) {
+                // as Matrix::findAngleBin, a guess corrected by one edge either side
+                constexpr double inverse = 1 / Layout::angleBins[0];
+                size_t guess = static_cast<size_t>(std::max(0.0, std::min(value * inverse, static_cast<double>(A - 1))));
+                return guess - (value <= angleEdges[guess]) + (value > angleEdges[guess + 1]);
+            } else {
+                return lowerBound(Layout::angleBins, value);
+            }
+        }
+};
+
+// Log-odds (or count) table over distance rows and angle columns. Each
+// bin is named by its upper edge, and values beyond the last edge fall
+// in the last bin. The table is one row-major array, and the bin lookups
+// avoid data-dependent branches: angle bins by arithmetic when they are
+// evenly spaced, distance bins by a branch-free binary search.
 class Matrix {
     public:
-        Matrix() : 
-            distanceBins(), 
-            angleBins(), 
-            table() 
-        {}
-        Matrix(const DoubleVector& distanceBins, const DoubleVector& angleBins) : 
-            distanceBins(distanceBins.begin(), distanceBins.end()), 
-            angleBins(angleBins.begin(), angleBins.end()), 
-            table(distanceBins.size(), 
-                  DoubleVector(angleBins.size(), 0.0)) 
-        {}
+        Matrix() {}
+        // zero table
+        Matrix(const DoubleVector& distanceBins, const DoubleVector& angleBins);
+        // table holds distanceBins.size() rows of angleBins.size() values
+        Matrix(const DoubleVector& distanceBins, const DoubleVector& angleBins, const DoubleVector& table);
         void increment(double distance, double angle, double value = 1.0);
         Matrix& prefixSum();
         Matrix& toECDF();
-        double score(double distance, double angle) const;
+        inline double score(double distance, double angle) const {
+            return table[findDistanceBin(distance) * angleBins.size() + findAngleBin(angle)];
+        }
+        // last distance bin edge, every distance beyond it scores as the last row
+        inline double maxDistance() const { return distanceBins.empty() ? 0 : distanceBins.back(); }
+        // score of a match beyond maxDistance() whose angle is unknown,
+        // the mean of the last row
+        double farScore() const;
+        // true if every entry of the last row is the same, so farScore()
+        // is exact for any match beyond maxDistance()
+        bool lastRowIsConstant() const;
+        // lets searches stop at maxDistance() even when the last row
+        // depends on angle, scoring what lies beyond as farScore()
+        inline void setCapFarMatches(bool cap) { capFarMatches = cap; }
+        // true if matches beyond maxDistance() score farScore(), exactly
+        // or because it was asked for
+        inline bool capsFarMatches() const { return capFarMatches || lastRowIsConstant(); }
+        // how far scoring needs to search for a match
+        inline double searchLimit() const { 
+            return capsFarMatches() ? maxDistance() : std::numeric_limits<double>::infinity(); 
+        }
+        uint64_t fingerprint() const;
         friend std::ostream& operator<<(std::ostream& out, const Matrix& mat);
-        inline DoubleVector& getDistanceBins() { return distanceBins; }
-        inline DoubleVector& getAngleBins() { return angleBins; }
-        inline DoubleVector2D& getTable() { return table; }
+        inline const DoubleVector& getDistanceBins() const { return distanceBins; }
+        inline const DoubleVector& getAngleBins() const { return angleBins; }
+        inline size_t rows() const { return distanceBins.size(); }
+        inline size_t cols() const { return angleBins.size(); }
+        // writing through it drops the FixedMatrix copy, see visit()
+        inline double& at(size_t row, size_t col) { 
+            fixed = std::monostate{};
+            return table[row * angleBins.size() + col]; 
+        }
+        inline double at(size_t row, size_t col) const { return table[row * angleBins.size() + col]; }
+
+        // Calls f with what to score through: a FixedMatrix copy when the
+        // bins are a known layout, otherwise this matrix. The dispatch
+        // happens once per call, so a loop in f inlines the lookups of
+        // whichever it is given. Matrices changed after construction
+        // always take the generic path.
+        template<typename F>
+        decltype(auto) visit(F&& f) const {
+            return std::visit([&](const auto& m) -> decltype(auto) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(m)>, std::monostate>) {
+                    return f(*this);
+                } else {
+                    return f(m);
+                }
+            }, fixed);
+        }
+        inline bool isFixed() const { return fixed.index() != 0; }
     private:
         DoubleVector distanceBins;
         DoubleVector angleBins;
-        DoubleVector2D table;
+        // row-major, one row per distance bin
+        DoubleVector table;
+        bool capFarMatches = false;
+
+        // upper edges searched for a bin: all but the last, which is open
+        DoubleVector distanceEdges;
+        // angle edges as above between -inf and +inf sentinels
+        DoubleVector angleEdges;
+        // 1 / bin width when the angle bins are evenly spaced from 0, else 0
+        double angleStepInverse = 0;
+
+        std::variant<
+            std::monostate,
+            FixedMatrix<NUM_DISTANCE_BINS, NUM_ANGLE_BINS>,
+            FixedMatrix<FCWB_NUM_DISTANCE_BINS, NUM_ANGLE_BINS>
+        > fixed;
 
-        int findDistanceBin(double value) const;
-        int findAngleBin(double value) const;
+        void buildLookup();
+        // copies the table into the first FixedMatrix whose layout matches
+        template<size_t I = 1>
+        void specialize() {
+            if constexpr (I < std::variant_size_v<decltype(fixed)>) {
+                using Fixed = std::variant_alternative_t<I, decltype(fixed)>;
+                if (Fixed::matches(distanceBins, angleBins)) {
+                    fixed.template emplace<I>(table);
+                } else {
+                    specialize<I + 1>();
+                }
+            }
+        }
+        inline size_t findDistanceBin(double value) const {
+            // lower bound among the closed edges, the last bin when none holds it
+            const double* base = distanceEdges.data();
+            size_t n = distanceEdges.size();
+            if (n == 0) return 0;
+            while (n > 1) {
+                size_t half = n / 2;
+                base = base[half] < value ? base + half : base;
+                n -= half;
+            }
+            return (base - distanceEdges.data()) + (*base < value);
+        }
+        inline size_t findAngleBin(double value) const {
+            if (angleStepInverse == 0) {
+                size_t bin = 0;
+                for (size_t i = 1; i + 1 < angleEdges.size(); ++i) bin += angleEdges[i] < value;
+                return bin;
+            }
+            // a guess off by at most one bin, then corrected against the
+            // edges on either side
+            double scaled = value * angleStepInverse;
+            double last = static_cast<double>(angleBins.size() - 1);
+            size_t guess = static_cast<size_t>(std::max(0.0, std::min(scaled, last)));
+            const double* edges = angleEdges.data() + 1;
+            return guess - (value <= edges[static_cast<std::ptrdiff_t>(guess) - 1]) + (value > edges[guess]);
+        }
 };
 
 #endif // MATRIX_HPP
\ No newline at end of file
@@ -14,7 +14,7 @@ namespace MatrixIO {
         if (!fin.is_open()){
             throw std::runtime_error("Cannot open " + filepath);
         }
-        Matrix m;
+        DoubleVector distanceBins, angleBins, table;
 
         std::string line;
         bool isHeader = true;
@@ -33,22 +33,22 @@ namespace MatrixIO {
                 for (size_t i = 1; i < parts.size(); ++i) {
                     // cos_0.1 (if sin will use the same format?)
                     auto position = parts[i].find('_');
-                    m.getAngleBins().push_back(std::stod(parts[i].substr(position + 1)));
+                    angleBins.push_back(std::stod(parts[i].substr(position + 1)));
                 }
                 continue;
             }
 
             // distance bin
             double upperDst = std::stod(parts[0]);
-            m.getDistanceBins().push_back(upperDst);
+            distanceBins.push_back(upperDst);
 
-            std::vector<double> row;
-            for (size_t i = 1; i < parts.size(); ++i) row.push_back(std::stod(parts[i]));
-
-            m.getTable().push_back(row);
+            if (parts.size() != angleBins.size() + 1) {
+                throw std::runtime_error("Wrong number of columns in " + filepath);
+            }
+            for (size_t i = 1; i < parts.size(); ++i) table.push_back(std::stod(parts[i]));
         }
 
-        return m;
+        return Matrix(distanceBins, angleBins, table);
     }
     Matrix buildCountsMatrixFromFile(const std::string& filepath, 
                                      const std::vector<double> distanceBins, 
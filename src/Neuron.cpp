@@ -0,0 +1,179 @@
+#include "Neuron.hpp"
+#include "FileIO.hpp"
+#include "NeuronIO.hpp"
+#include "NeuronIndex.hpp"
+#include "StringUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+Neuron makeNeuron(const PointVector& points) {
+    Neuron n;
+    n.midpoints.reserve(points.size());
+    n.tangents.reserve(points.size());
+
+    for (const auto& pt : points) {
+        if (pt.parent == POINT_DEFAULT_PARENT) continue;
+        const Point& parent = points[pt.parent];
+        Point m = pt.midpoint(parent);
+        Point r = parent - pt;
+
+        double magnitude = r.magnitude();
+        if (magnitude == 0) {
+            n.tangents.emplace_back(pt.id, 0.0, 0.0, 0.0, POINT_DEFAULT_PARENT);
+        } else {
+            n.tangents.emplace_back(pt.id, r.x / magnitude, r.y / magnitude, r.z / magnitude, POINT_DEFAULT_PARENT);
+        }
+        // midpoint: id = original id, parent = -1
+        n.midpoints.emplace_back(pt.id, m.x, m.y, m.z, POINT_DEFAULT_PARENT);
+    }
+    n.bounds = boundingBox(n.midpoints);
+    return n;
+}
+
+PointVector resamplePoints(const PointVector& points, double step) {
+    std::vector<int> numChildren(points.size());
+    int nextID = 0;
+    for (const auto& p : points) {
+        if (p.parent != POINT_DEFAULT_PARENT) ++numChildren[p.parent];
+        nextID = std::max(nextID, p.id + 1);
+    }
+    // per point, the path length left to the kept point ending its stretch,
+    // children come after their parents so it is summed back to front
+    std::vector<double> remaining(points.size());
+    for (size_t i = points.size(); i-- > 0;) {
+        const Point& p = points[i];
+        if (p.parent == POINT_DEFAULT_PARENT || numChildren[p.parent] != 1) continue;
+        remaining[p.parent] = (numChildren[i] == 1 ? remaining[i] : 0) + p.distance(points[p.parent]);
+    }
+    // no point is drawn closer than this to the kept point after it, the
+    // last step of a stretch absorbs the remainder instead
+    const double minGap = RESAMPLE_MIN_GAP * step;
+
+    PointVector res;
+    res.reserve(points.size());
+    // per point, the last point written on the way to it and the path
+    // length between them
+    std::vector<int> lastOut(points.size());
+    std::vector<double> carry(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        const Point& p = points[i];
+        if (p.parent == POINT_DEFAULT_PARENT) {
+            lastOut[i] = res.size();
+            carry[i] = 0;
+            res.emplace_back(p.id, p.x, p.y, p.z, POINT_DEFAULT_PARENT);
+            continue;
+        }
+        const Point& parent = points[p.parent];
+        double length = p.distance(parent);
+        int out = lastOut[p.parent];
+        // points strictly inside the edge from the parent, step apart
+        // along the whole stretch and minGap short of its end
+        const double last = length + (numChildren[i] == 1 ? remaining[i] : 0) - minGap;
+        double t = step - carry[p.parent];
+        for (; t < length && t <= last; t += step) {
+            double f = t / length;
+            res.emplace_back(nextID++, parent.x + f * (p.x - parent.x), parent.y + f * (p.y - parent.y), 
+                             parent.z + f * (p.z - parent.z), out);
+            out = res.size() - 1;
+        }
+        if (numChildren[i] != 1) {
+            // branch point or leaf, kept as it is
+            res.emplace_back(p.id, p.x, p.y, p.z, out);
+            lastOut[i] = res.size() - 1;
+            carry[i] = 0;
+        } else {
+            lastOut[i] = out;
+            carry[i] = length - (t - step);
+        }
+    }
+    return res;
+}
+
+Neuron coarsenNeuron(const Neuron& neuron, double step) {
+    using Voxel = std::tuple<int64_t, int64_t, int64_t>;
+    auto voxel = [step](const Point& p) {
+        return Voxel{ static_cast<int64_t>(std::floor(p.x / step)), 
+                      static_cast<int64_t>(std::floor(p.y / step)), 
+                      static_cast<int64_t>(std::floor(p.z / step)) };
+    };
+    std::vector<Voxel> voxels;
+    voxels.reserve(neuron.size());
+    for (const auto& m : neuron.midpoints) voxels.push_back(voxel(m));
+    std::vector<size_t> order(neuron.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return voxels[a] < voxels[b]; });
+
+    Neuron n;
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin;
+        double mx = 0, my = 0, mz = 0, tx = 0, ty = 0, tz = 0;
+        const Point* reference = nullptr;
+        for (; end < order.size() && voxels[order[end]] == voxels[order[begin]]; ++end) {
+            const Point& m = neuron.midpoints[order[end]];
+            const Point& t = neuron.tangents[order[end]];
+            mx += m.x; my += m.y; mz += m.z;
+            // directions are unsigned, so they are flipped to agree before summing
+            if (!reference && (t.x != 0 || t.y != 0 || t.z != 0)) reference = &t;
+            double sign = reference && normedDotProduct(*reference, t) < 0 ? -1 : 1;
+            tx += sign * t.x; ty += sign * t.y; tz += sign * t.z;
+        }
+        double count = end - begin;
+        int id = neuron.midpoints[order[begin]].id;
+        n.midpoints.emplace_back(id, mx / count, my / count, mz / count, POINT_DEFAULT_PARENT);
+        double magnitude = std::sqrt(tx * tx + ty * ty + tz * tz);
+        if (magnitude == 0) {
+            n.tangents.emplace_back(id, 0.0, 0.0, 0.0, POINT_DEFAULT_PARENT);
+        } else {
+            n.tangents.emplace_back(id, tx / magnitude, ty / magnitude, tz / magnitude, POINT_DEFAULT_PARENT);
+        }
+        begin = end;
+    }
+    n.bounds = boundingBox(n.midpoints);
+    return n;
+}
+
+BoundingBox boundingBox(const PointVector& points) {
+    BoundingBox box;
+    for (const auto& p : points) {
+        const double c[3] = { p.x, p.y, p.z };
+        for (int d = 0; d < 3; ++d) {
+            box.min[d] = std::min(box.min[d], c[d]);
+            box.max[d] = std::max(box.max[d], c[d]);
+        }
+    }
+    return box;
+}
+
+double BoundingBox::distanceSqr(const BoundingBox& other) const {
+    double sum = 0;
+    for (int d = 0; d < 3; ++d) {
+        double gap = std::max({ 0.0, min[d] - other.max[d], other.min[d] - max[d] });
+        sum += gap * gap;
+    }
+    return sum;
+}
+
+size_t neuronBytes(const Neuron& neuron) {
+    return sizeof(Neuron) + (neuron.midpoints.capacity() + neuron.tangents.capacity()) * sizeof(Point) 
+        + (neuron.index ? neuron.index->bytes() : 0);
+}
+
+Neuron loadNeuron(const std::string& filepath, double resampleStep) {
+    if (hasExtension(filepath, NEURON_BINARY_EXT)) {
+        if (resampleStep > 0) {
+            throw std::runtime_error("Cannot resample binary neuron " + filepath + ", convert it with --resample instead");
+        }
+        return NeuronIO::readBinary(filepath);
+    }
+    PointVector points = loadPoints(filepath);
+    if (resampleStep > 0) {
+        points = resamplePoints(points, resampleStep);
+    }
+    return makeNeuron(points);
+}
@@ -0,0 +1,82 @@
+#ifndef NEURON_HPP
+#define NEURON_HPP
+
+#include "Point.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class NeuronIndex;
+
+// axis-aligned box around a neuron's midpoints, empty (min above max)
+// when there are none
+struct BoundingBox {
+    double min[3] = { INFINITY, INFINITY, INFINITY };
+    double max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    inline bool empty() const { return min[0] > max[0]; }
+    // squared distance between the closest points of two non-empty boxes
+    double distanceSqr(const BoundingBox& other) const;
+    // squared distance from a point to the closest point of the box
+    inline double distanceSqr(const Point& p) const {
+        double dx = std::max({ 0.0, min[0] - p.x, p.x - max[0] });
+        double dy = std::max({ 0.0, min[1] - p.y, p.y - max[1] });
+        double dz = std::max({ 0.0, min[2] - p.z, p.z - max[2] });
+        return dx * dx + dy * dy + dz * dz;
+    }
+};
+BoundingBox boundingBox(const PointVector& points);
+
+// A neuron reduced to what the scorer needs: one midpoint and one unit
+// direction per segment, plus the per-neuron values reused across every
+// pair it takes part in.
+struct Neuron {
+    // segment midpoints, id = swc id of the segment's child point
+    PointVector midpoints;
+    // unit direction of each segment, zero for zero-length segments
+    PointVector tangents;
+    // raw score of the neuron against itself
+    double selfScore = 0.0;
+    // scoringKey() the self-score was computed under, 0 if unset
+    uint64_t selfScoreKey = 0;
+    // box around the midpoints, set wherever they are
+    BoundingBox bounds;
+    // KD-tree over the midpoints, null until built or loaded
+    std::shared_ptr<const NeuronIndex> index;
+
+    inline size_t size() const { return midpoints.size(); }
+};
+
+Neuron makeNeuron(const PointVector& points);
+// The skeleton redrawn with points every step along each unbranched
+// stretch, keeping its roots, branch points and leaves. No point is drawn
+// within RESAMPLE_MIN_GAP steps of the end of its stretch, so a stretch
+// ends in one piece of up to 1 + RESAMPLE_MIN_GAP steps rather than a
+// sliver. Points come back topologically ordered like loadPoints(); new
+// points get ids above the largest swc id.
+constexpr double RESAMPLE_MIN_GAP = 0.5;
+PointVector resamplePoints(const PointVector& points, double step);
+// one segment per occupied voxel of edge step: the mean of the midpoints
+// in it, heading along their mean direction. No self-score or tree.
+Neuron coarsenNeuron(const Neuron& neuron, double step);
+// approximate heap footprint of a loaded neuron
+size_t neuronBytes(const Neuron& neuron);
+// swc files are resampled to resampleStep first unless it is 0, binary
+// neurons cannot be
+Neuron loadNeuron(const std::string& filepath, double resampleStep = 0.0);
+
+// angle measure between two unit segment directions, -1 if either is
+// degenerate. Inline, it runs once per match.
+inline double segmentAngleMeasure(const Point& u, const Point& v, bool doSine) {
+    double angleMeasure = std::abs(normedDotProduct(u, v));
+    // directions are unit length or exactly zero
+    auto degenerate = [](const Point& p) { return p.x == 0 && p.y == 0 && p.z == 0; };
+    if (angleMeasure == 0 && (degenerate(u) || degenerate(v))) return -1;
+    if (angleMeasure > 1) angleMeasure = 1;
+    return doSine ? sineFromCosine(angleMeasure) : angleMeasure;
+}
+
+#endif // NEURON_HPP
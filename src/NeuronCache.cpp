@@ -0,0 +1,122 @@
+#include "NeuronCache.hpp"
+#include "Logging.hpp"
+#include "Scoring.hpp"
+#include "StringUtils.hpp"
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+static uint64_t estimateBytes(const std::string& key, const Neuron& neuron) {
+    return neuronBytes(neuron) + key.capacity();
+}
+
+std::shared_ptr<const Neuron> NeuronCache::get(const Dataset& dataset, const std::string& neuronID) {
+    std::string key = filenameToPath(dataset.getPath(), neuronID);
+    NeuronFuture neuron;
+    NeuronPromise promise;
+    bool isLoader = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            ++hits;
+            // move to front, iterators stay valid
+            entries.splice(entries.begin(), entries, it->second);
+            neuron = it->second->neuron;
+        } else {
+            ++misses;
+            neuron = insertLoading(key, promise);
+            isLoader = true;
+        }
+    }
+    if (isLoader) {
+        LOG_DEBUG("neuron cache miss: \"%s\"", key.c_str());
+        load(dataset, neuronID, key, promise);
+    }
+    return neuron.get();
+}
+
+void NeuronCache::prefetch(const Dataset& dataset, const std::string& neuronID) {
+    if (!prefetchPool) return;
+    std::string key = filenameToPath(dataset.getPath(), neuronID);
+    auto promise = std::make_shared<NeuronPromise>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index.find(key) != index.end()) return;
+        ++prefetches;
+        insertLoading(key, *promise);
+    }
+    prefetchPool->submit([this, &dataset, neuronID, key, promise]() {
+        load(dataset, neuronID, key, *promise);
+    });
+}
+
+void NeuronCache::enablePrefetch(size_t numThreads) {
+    prefetchPool = std::make_unique<ThreadPool>(numThreads);
+}
+
+NeuronCache::NeuronFuture NeuronCache::insertLoading(const std::string& key, NeuronPromise& promise) {
+    NeuronFuture neuron = promise.get_future().share();
+    entries.push_front(Entry{ key, neuron, 0, true });
+    index[key] = entries.begin();
+    return neuron;
+}
+
+void NeuronCache::load(const Dataset& dataset, const std::string& neuronID, 
+                       const std::string& key, NeuronPromise& promise) {
+    std::shared_ptr<const Neuron> neuron;
+    try {
+        Neuron loaded = dataset.load(neuronID);
+        if (mat) {
+            ensureSelfScore(loaded, *mat, doSine);
+        }
+        neuron = std::make_shared<const Neuron>(std::move(loaded));
+    } catch (...) {
+        // forget the entry so a later get() retries, and fail every waiter
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = index.find(key);
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        promise.set_exception(std::current_exception());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = *index.at(key);
+        entry.loading = false;
+        entry.bytes = estimateBytes(key, *neuron);
+        sizeBytes += entry.bytes;
+        evict();
+    }
+    promise.set_value(std::move(neuron));
+}
+
+void NeuronCache::evict() {
+    // oldest first, skipping loads in flight, and never the newest entry
+    auto it = entries.end();
+    while (sizeBytes > capacityBytes && it != entries.begin()) {
+        --it;
+        if (it->loading || it == entries.begin()) continue;
+        LOG_DEBUG("neuron cache evict: \"%s\"", it->key.c_str());
+        sizeBytes -= it->bytes;
+        index.erase(it->key);
+        it = entries.erase(it);
+        ++evictions;
+    }
+}
+
+void NeuronCache::print(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t lookups = hits + misses;
+    out << "Cache Hits: " << hits << "\n";
+    out << "Cache Misses: " << misses << "\n";
+    out << "Cache Hit Rate: " << (lookups ? static_cast<double>(hits) / lookups : 0.0) << "\n";
+    out << "Cache Prefetches: " << prefetches << "\n";
+    out << "Cache Evictions: " << evictions << "\n";
+    out << "Cache Entries: " << entries.size() << "\n";
+    out << "Cache Bytes: " << sizeBytes << " / " << capacityBytes << "\n";
+}
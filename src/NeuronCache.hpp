@@ -0,0 +1,83 @@
+#ifndef NEURON_CACHE_HPP
+#define NEURON_CACHE_HPP
+
+#include "Matrix.hpp"
+#include "Neuron.hpp"
+#include "Dataset.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// Bounded LRU cache of loaded neurons, keyed by dataset path and
+// neuron ID. Entries are handed out as shared pointers so an evicted
+// neuron stays valid for as long as a caller is still scoring it.
+// Self-scores are computed with the given matrix on load unless the
+// neuron's binary form already holds one for it, or skipped if no
+// matrix is given.
+//
+// The cache is safe to use from several threads. A neuron is loaded at
+// most once: callers asking for one that is still loading wait for that
+// load instead of starting another. With enablePrefetch(), prefetch()
+// starts loads on background threads ahead of the get() that needs them.
+class NeuronCache : public NeuronSource {
+    public:
+        NeuronCache(uint64_t capacityBytes, const Matrix* mat = nullptr, bool doSine = false) 
+            : mat(mat), doSine(doSine), capacityBytes(capacityBytes) {}
+
+        std::shared_ptr<const Neuron> get(const Dataset& dataset, const std::string& neuronID) override;
+        void prefetch(const Dataset& dataset, const std::string& neuronID) override;
+        void enablePrefetch(size_t numThreads);
+
+        inline uint64_t getHits() const { return hits; }
+        inline uint64_t getMisses() const { return misses; }
+        inline uint64_t getPrefetches() const { return prefetches; }
+        inline uint64_t getEvictions() const { return evictions; }
+        inline uint64_t getSizeBytes() const { return sizeBytes; }
+        inline size_t getCount() const { return entries.size(); }
+
+        void print(std::ostream& out) const override;
+    private:
+        using NeuronFuture = std::shared_future<std::shared_ptr<const Neuron>>;
+        using NeuronPromise = std::promise<std::shared_ptr<const Neuron>>;
+        struct Entry {
+            std::string key;
+            NeuronFuture neuron;
+            uint64_t bytes;
+            // still loading, never evicted
+            bool loading;
+        };
+        using EntryList = std::list<Entry>;
+
+        mutable std::mutex mutex;
+        // most recently used at the front
+        EntryList entries;
+        std::unordered_map<std::string, EntryList::iterator> index;
+
+        const Matrix* mat;
+        bool doSine;
+
+        uint64_t capacityBytes;
+        uint64_t sizeBytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t prefetches = 0;
+        uint64_t evictions = 0;
+
+        // declared last so its workers are joined before the cache goes away
+        std::unique_ptr<ThreadPool> prefetchPool;
+
+        // inserts a loading entry for key, caller holds the mutex
+        NeuronFuture insertLoading(const std::string& key, NeuronPromise& promise);
+        void load(const Dataset& dataset, const std::string& neuronID, 
+                  const std::string& key, NeuronPromise& promise);
+        void evict();
+};
+
+#endif // NEURON_CACHE_HPP
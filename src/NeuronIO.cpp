@@ -0,0 +1,138 @@
+#include "NeuronIO.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace NeuronIO {
+
+    static constexpr char MAGIC[4] = { 'N', 'B', 'N', '1' };
+    // version 2 appends the saved KD-tree, version 3 tags it with its 
+    // coordinate width; older records are still read
+    static constexpr uint32_t VERSION = 3;
+    static constexpr size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint32_t) 
+        + 2 * sizeof(uint64_t) + sizeof(double);
+
+    template<typename T>
+    static void appendValue(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    // records are not aligned inside a pack, copy out of the byte stream
+    template<typename T>
+    static const char* readValue(const char* data, T& value) {
+        std::memcpy(&value, data, sizeof(T));
+        return data + sizeof(T);
+    }
+
+    // always stored as doubles, whatever coord_t the build uses
+    static void appendCoordinates(std::string& buffer, const PointVector& pts) {
+        for (const auto& p : pts) {
+            appendValue(buffer, static_cast<double>(p.x));
+            appendValue(buffer, static_cast<double>(p.y));
+            appendValue(buffer, static_cast<double>(p.z));
+        }
+    }
+    static const char* readCoordinates(const char* data, const std::vector<int32_t>& ids, PointVector& pts) {
+        pts.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            double xyz[3];
+            std::memcpy(xyz, data, sizeof(xyz));
+            data += sizeof(xyz);
+            pts.emplace_back(ids[i], xyz[0], xyz[1], xyz[2], POINT_DEFAULT_PARENT);
+        }
+        return data;
+    }
+
+    void encode(const Neuron& neuron, std::string& buffer) {
+        uint64_t count = neuron.size();
+        buffer.reserve(buffer.size() + HEADER_SIZE + count * (sizeof(int32_t) + 6 * sizeof(double)));
+        buffer.append(MAGIC, sizeof(MAGIC));
+        appendValue(buffer, VERSION);
+        appendValue(buffer, count);
+        appendValue(buffer, neuron.selfScoreKey);
+        appendValue(buffer, neuron.selfScore);
+        for (const auto& m : neuron.midpoints) {
+            appendValue(buffer, static_cast<int32_t>(m.id));
+        }
+        appendCoordinates(buffer, neuron.midpoints);
+        appendCoordinates(buffer, neuron.tangents);
+
+        // coordinate width, uint64 length then the tree, 0 if there is none
+        appendValue(buffer, static_cast<uint32_t>(sizeof(coord_t)));
+        size_t lengthOffset = buffer.size();
+        appendValue(buffer, uint64_t{0});
+        if (neuron.index) {
+            neuron.index->save(buffer);
+            uint64_t indexBytes = buffer.size() - lengthOffset - sizeof(uint64_t);
+            std::memcpy(buffer.data() + lengthOffset, &indexBytes, sizeof(indexBytes));
+        }
+    }
+
+    Neuron decode(const char* data, size_t size, const std::string& source) {
+        if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a binary neuron: " + source);
+        }
+        const char* ptr = data + sizeof(MAGIC);
+        uint32_t version = 0;
+        uint64_t count = 0;
+        Neuron n;
+        ptr = readValue(ptr, version);
+        ptr = readValue(ptr, count);
+        ptr = readValue(ptr, n.selfScoreKey);
+        ptr = readValue(ptr, n.selfScore);
+        if (version < 1 || version > VERSION) {
+            throw std::runtime_error("Unsupported binary neuron version in " + source);
+        } else if ((size - HEADER_SIZE) / (sizeof(int32_t) + 6 * sizeof(double)) < count) {
+            throw std::runtime_error("Truncated binary neuron: " + source);
+        }
+
+        std::vector<int32_t> ids(count);
+        std::memcpy(ids.data(), ptr, count * sizeof(int32_t));
+        ptr += count * sizeof(int32_t);
+        ptr = readCoordinates(ptr, ids, n.midpoints);
+        ptr = readCoordinates(ptr, ids, n.tangents);
+        n.bounds = boundingBox(n.midpoints);
+        if (version == 1) return n;
+
+        const char* end = data + size;
+        uint32_t treeCoordBytes = sizeof(double);
+        uint64_t indexBytes = 0;
+        size_t tagBytes = version >= 3 ? sizeof(treeCoordBytes) : 0;
+        if (static_cast<size_t>(end - ptr) < tagBytes + sizeof(indexBytes)) {
+            throw std::runtime_error("Truncated binary neuron: " + source);
+        }
+        if (version >= 3) ptr = readValue(ptr, treeCoordBytes);
+        ptr = readValue(ptr, indexBytes);
+        if (static_cast<uint64_t>(end - ptr) < indexBytes) {
+            throw std::runtime_error("Truncated binary neuron: " + source);
+        }
+        // a tree saved by a build with another coord_t is rebuilt on load
+        if (indexBytes > 0 && treeCoordBytes == sizeof(coord_t)) {
+            n.index = std::make_shared<const NeuronIndex>(n.midpoints, ptr, indexBytes, source);
+        }
+        return n;
+    }
+
+    void writeBinary(const std::string& filepath, const Neuron& neuron) {
+        std::ofstream fout(filepath, std::ios::binary | std::ios::trunc);
+        if (!fout) { throw std::runtime_error("Cannot open " + filepath); }
+        std::string buffer;
+        encode(neuron, buffer);
+        fout.write(buffer.data(), buffer.size());
+        if (!fout) { throw std::runtime_error("Failed writing " + filepath); }
+    }
+
+    Neuron readBinary(const std::string& filepath) {
+        std::ifstream fin(filepath, std::ios::binary);
+        if (!fin) { throw std::runtime_error("Cannot open " + filepath); }
+        std::vector<char> buffer((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+        return decode(buffer.data(), buffer.size(), filepath);
+    }
+
+} // namespace NeuronIO
@@ -0,0 +1,34 @@
+#ifndef NEURON_IO_HPP
+#define NEURON_IO_HPP
+
+#include "Neuron.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+constexpr const char *NEURON_BINARY_EXT = ".nbn";
+
+namespace NeuronIO {
+
+    // Binary neuron (.nbn) layout, host byte order:
+    //   char[4]  magic "NBN1"
+    //   uint32   version
+    //   uint64   number of segments n
+    //   uint64   scoringKey() of the self-score, 0 if unset
+    //   double   self-score
+    //   int32[n]     swc id of each segment's child point
+    //   double[3n]   segment midpoints, x y z interleaved
+    //   double[3n]   unit segment directions, x y z interleaved
+    //   uint32   sizeof(coord_t) of the saved KD-tree (version 3)
+    //   uint64   length of the saved KD-tree, 0 if none (version 2)
+    //   byte[]   KD-tree over the midpoints in nanoflann's saveIndex form
+    void encode(const Neuron& neuron, std::string& buffer);
+    Neuron decode(const char* data, size_t size, const std::string& source);
+
+    void writeBinary(const std::string& filepath, const Neuron& neuron);
+    Neuron readBinary(const std::string& filepath);
+
+} // namespace NeuronIO
+
+#endif // NEURON_IO_HPP
@@ -0,0 +1,237 @@
+#include "NeuronIndex.hpp"
+#include "Neuron.hpp"
+#include "BruteForceNN.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+// points per KD-tree leaf
+static constexpr size_t LEAF_SIZE = 10;
+// widens a search bound taken from a neighbouring query, so the tree's
+// rounded cut distances cannot prune the subtree holding the answer
+static constexpr coord_t BOUND_SLACK = 1 + 1e-4;
+// a squared distance bound widened by BOUND_SLACK, infinite beyond the
+// largest finite value
+static coord_t widen(coord_t distSqr) {
+    if (distSqr > std::numeric_limits<coord_t>::max() / BOUND_SLACK) {
+        return std::numeric_limits<coord_t>::infinity();
+    }
+    return distSqr * BOUND_SLACK + std::numeric_limits<coord_t>::min();
+}
+// bits per axis of a Morton code
+static constexpr unsigned MORTON_BITS = 21;
+
+// read-only stream over a byte range, loadIndex() only takes a stream
+class ByteRangeBuf : public std::streambuf {
+    public:
+        ByteRangeBuf(const char* data, size_t size) {
+            char* begin = const_cast<char*>(data);
+            setg(begin, begin, begin + size);
+        }
+};
+
+// nanoflann result set for the single nearest point closer than a
+// bound. Ties keep the first point found, as KNNResultSet does.
+class BoundedNearest {
+    public:
+        using DistanceType = coord_t;
+        using IndexType = size_t;
+        using CountType = size_t;
+
+        explicit BoundedNearest(coord_t bound) : worst(bound) {}
+
+        inline bool addPoint(coord_t dist, size_t index) {
+            if (dist < worst) {
+                worst = dist;
+                nearestIdx = index;
+                found = true;
+            }
+            return true;
+        }
+        inline coord_t worstDist() const { return worst; }
+        inline bool full() const { return found; }
+        inline size_t size() const { return found ? 1 : 0; }
+        inline void sort() {}
+
+        coord_t worst;
+        size_t nearestIdx = 0;
+        bool found = false;
+};
+
+// spreads the low 21 bits of v two bits apart
+static uint64_t spreadBits(uint64_t v) {
+    v &= (uint64_t{1} << MORTON_BITS) - 1;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+std::vector<uint32_t> NeuronIndex::mortonOrder(const PointVector& pts) {
+    if (pts.empty()) return {};
+    double lo[3] = { pts[0].x, pts[0].y, pts[0].z };
+    double extent = 0;
+    for (const auto& p : pts) {
+        lo[0] = std::min<double>(lo[0], p.x);
+        lo[1] = std::min<double>(lo[1], p.y);
+        lo[2] = std::min<double>(lo[2], p.z);
+    }
+    for (const auto& p : pts) {
+        extent = std::max({ extent, p.x - lo[0], p.y - lo[1], p.z - lo[2] });
+    }
+    // one scale for all axes keeps the curve's cells cubic
+    const double scale = extent > 0 ? ((uint64_t{1} << MORTON_BITS) - 1) / extent : 0;
+
+    std::vector<std::pair<uint64_t, uint32_t>> keyed(pts.size());
+    for (size_t i = 0; i < pts.size(); ++i) {
+        const Point& p = pts[i];
+        uint64_t code = spreadBits(static_cast<uint64_t>((p.x - lo[0]) * scale))
+            | spreadBits(static_cast<uint64_t>((p.y - lo[1]) * scale)) << 1
+            | spreadBits(static_cast<uint64_t>((p.z - lo[2]) * scale)) << 2;
+        keyed[i] = { code, static_cast<uint32_t>(i) };
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<uint32_t> order(pts.size());
+    for (size_t i = 0; i < keyed.size(); ++i) order[i] = keyed[i].second;
+    return order;
+}
+
+NeuronIndex::Cloud NeuronIndex::makeCloud(const PointVector& midpoints) {
+    Cloud cloud;
+    cloud.count = midpoints.size();
+    size_t padded = (cloud.count + BRUTE_FORCE_PADDING - 1) / BRUTE_FORCE_PADDING * BRUTE_FORCE_PADDING;
+    for (auto& axis : cloud.axis) {
+        axis.assign(padded, std::numeric_limits<coord_t>::quiet_NaN());
+    }
+    for (size_t i = 0; i < cloud.count; ++i) {
+        cloud.axis[0][i] = midpoints[i].x;
+        cloud.axis[1][i] = midpoints[i].y;
+        cloud.axis[2][i] = midpoints[i].z;
+    }
+    return cloud;
+}
+
+NeuronIndex::NeuronIndex(const PointVector& midpoints) 
+    : cloud(makeCloud(midpoints)), order(mortonOrder(midpoints)) {}
+
+NeuronIndex::NeuronIndex(const PointVector& midpoints, const char* data, size_t size, const std::string& source) 
+    : cloud(makeCloud(midpoints)), order(mortonOrder(midpoints)) {
+    std::call_once(treeBuilt, [&]() {
+        tree = std::make_unique<KDTree>(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(LEAF_SIZE, 
+            nanoflann::KDTreeSingleIndexAdaptorFlags::SkipInitialBuildIndex));
+        ByteRangeBuf buf(data, size);
+        std::istream in(&buf);
+        tree->loadIndex(in);
+        if (!in || tree->size_ != cloud.count || tree->vAcc_.size() != cloud.count) {
+            throw std::runtime_error("Corrupt KD-tree index in " + source);
+        }
+    });
+}
+
+const NeuronIndex::KDTree& NeuronIndex::getTree() const {
+    std::call_once(treeBuilt, [this]() {
+        tree = std::make_unique<KDTree>(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(LEAF_SIZE));
+    });
+    return *tree;
+}
+
+void NeuronIndex::save(std::string& buffer) const {
+    std::ostringstream out;
+    getTree().saveIndex(out);
+    buffer += out.str();
+}
+
+size_t NeuronIndex::nearest(const coord_t pt[3], coord_t& distSqr) const {
+    const BruteForceKernel& kernel = bruteForceKernel();
+    if (cloud.count <= kernel.maxPoints) {
+        size_t nearestIdx;
+        if (kernel.nearest(cloud.axis[0].data(), cloud.axis[1].data(), cloud.axis[2].data(), 
+                           cloud.axis[0].size(), pt, nearestIdx, distSqr)) {
+            return nearestIdx;
+        }
+        // tied, only the tree knows which one it would have picked
+    }
+    return nearestInTree(pt, distSqr);
+}
+
+size_t NeuronIndex::nearestInTree(const coord_t pt[3], coord_t& distSqr) const {
+    size_t nearestIdx = 0;
+    nanoflann::KNNResultSet<coord_t> resultSet(1);
+    resultSet.init(&nearestIdx, &distSqr);
+    getTree().findNeighbors(resultSet, pt);
+    return nearestIdx;
+}
+
+void NeuronIndex::nearestAll(const PointVector& pts, const std::vector<uint32_t>& order, 
+                             std::vector<size_t>& nearestIdx, std::vector<coord_t>& distSqr,
+                             coord_t maxDistSqr) const {
+    nearestIdx.resize(pts.size());
+    distSqr.resize(pts.size());
+    if (cloud.count <= bruteForceKernel().maxPoints) {
+        // a scan reads every midpoint whatever the order or radius
+        for (size_t i = 0; i < pts.size(); ++i) {
+            coord_t pt[3] = { pts[i].x, pts[i].y, pts[i].z };
+            nearestIdx[i] = nearest(pt, distSqr[i]);
+            if (distSqr[i] > maxDistSqr) nearestIdx[i] = NONE;
+        }
+        return;
+    }
+
+    const KDTree& kdtree = getTree();
+    const coord_t radiusBound = widen(maxDistSqr);
+    size_t previous = NONE;
+    for (size_t k = 0; k < order.size(); ++k) {
+        const Point& p = pts[order[k]];
+        coord_t pt[3] = { p.x, p.y, p.z };
+
+        // the previous point's neighbour is at most this far away, so
+        // nothing further needs looking at
+        coord_t bound = radiusBound;
+        if (previous != NONE) {
+            coord_t dx = pt[0] - cloud.axis[0][previous];
+            coord_t dy = pt[1] - cloud.axis[1][previous];
+            coord_t dz = pt[2] - cloud.axis[2][previous];
+            bound = std::min(bound, widen(dx * dx + dy * dy + dz * dz));
+        }
+        BoundedNearest result(bound);
+        kdtree.findNeighbors(result, pt);
+        if (!result.found && bound < radiusBound) {
+            result = BoundedNearest(radiusBound);
+            kdtree.findNeighbors(result, pt);
+        }
+        // the bounds are widened, the radius itself is exact
+        if (!result.found || result.worst > maxDistSqr) {
+            nearestIdx[order[k]] = NONE;
+            distSqr[order[k]] = result.worst;
+            continue;
+        }
+        nearestIdx[order[k]] = result.nearestIdx;
+        distSqr[order[k]] = result.worst;
+        previous = result.nearestIdx;
+    }
+}
+
+size_t NeuronIndex::bytes() const {
+    // coordinates, then the permutation and about one node per leaf
+    // for neurons large enough to need the tree
+    size_t n = cloud.count;
+    size_t coordinates = 3 * cloud.axis[0].capacity() * sizeof(coord_t);
+    size_t treeBytes = n > bruteForceKernel().maxPoints 
+        ? n * sizeof(size_t) + (2 * n / LEAF_SIZE + 1) * sizeof(KDTree::Node) : 0;
+    return sizeof(NeuronIndex) + coordinates + order.capacity() * sizeof(uint32_t) + treeBytes;
+}
+
+void ensureIndex(Neuron& neuron) {
+    if (neuron.index || neuron.size() == 0) return;
+    neuron.index = std::make_shared<const NeuronIndex>(neuron.midpoints);
+}
@@ -0,0 +1,93 @@
+#ifndef NEURON_INDEX_HPP
+#define NEURON_INDEX_HPP
+
+#include "Point.hpp"
+#include "nanoflann.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct Neuron;
+
+// Nearest-neighbour index over a neuron's segment midpoints, built once
+// per loaded neuron rather than once per scored pair. It keeps its own
+// copy of the coordinates, so it stays valid however the owning Neuron
+// is copied or moved.
+//
+// Small neurons are searched exhaustively with a SIMD scan, larger ones
+// through a KD-tree. The tree is only built when first needed, and can
+// be saved into the neuron's binary record and restored without
+// rebuilding it. The midpoints' Morton order is kept alongside, for
+// when the neuron is the query side of a pair.
+class NeuronIndex {
+    public:
+        static constexpr size_t NONE = static_cast<size_t>(-1);
+
+        explicit NeuronIndex(const PointVector& midpoints);
+        // restores a tree written by save() for the same midpoints
+        NeuronIndex(const PointVector& midpoints, const char* data, size_t size, const std::string& source);
+        NeuronIndex(const NeuronIndex&) = delete;
+        NeuronIndex& operator=(const NeuronIndex&) = delete;
+
+        // appends the tree, without the coordinates, to buffer
+        void save(std::string& buffer) const;
+
+        // position of the midpoint nearest to pt, squared distance in distSqr
+        size_t nearest(const coord_t pt[3], coord_t& distSqr) const;
+        // the same, always through the KD-tree
+        size_t nearestInTree(const coord_t pt[3], coord_t& distSqr) const;
+        // nearest() for every point of pts, results stored by position in
+        // pts. Tree searches run in the given order, each one bounded by
+        // the distance to the previous search's neighbour, so consecutive
+        // searches walk the same few nodes. Points with no midpoint within
+        // maxDistSqr get NONE, and the tree is not searched beyond it.
+        void nearestAll(const PointVector& pts, const std::vector<uint32_t>& order, 
+                        std::vector<size_t>& nearestIdx, std::vector<coord_t>& distSqr,
+                        coord_t maxDistSqr = std::numeric_limits<coord_t>::max()) const;
+
+        // positions of this index's midpoints along a Morton curve
+        inline const std::vector<uint32_t>& curveOrder() const { return order; }
+        // positions of pts along a Morton curve over their bounding box
+        static std::vector<uint32_t> mortonOrder(const PointVector& pts);
+
+        inline size_t size() const { return cloud.count; }
+        // approximate heap footprint
+        size_t bytes() const;
+    private:
+        // nanoflann dataset adaptor over the copied coordinates, one array
+        // per axis padded with NaN for the SIMD scan
+        struct Cloud {
+            std::array<std::vector<coord_t>, 3> axis;
+            size_t count = 0;
+
+            inline size_t kdtree_get_point_count() const { return count; }
+            inline coord_t kdtree_get_pt(size_t idx, size_t dim) const { return axis[dim][idx]; }
+            template<class BBOX>
+            bool kdtree_get_bbox(BBOX&) const { return false; }
+        };
+        using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
+            nanoflann::L2_Simple_Adaptor<coord_t, Cloud>,
+            Cloud,
+            3
+        >;
+
+        Cloud cloud;
+        std::vector<uint32_t> order;
+        // built on first use, shared by every thread scoring against this neuron
+        mutable std::once_flag treeBuilt;
+        mutable std::unique_ptr<KDTree> tree;
+
+        const KDTree& getTree() const;
+        static Cloud makeCloud(const PointVector& midpoints);
+};
+
+// builds neuron.index if it is not already there
+void ensureIndex(Neuron& neuron);
+
+#endif // NEURON_INDEX_HPP
@@ -0,0 +1,144 @@
+#include "NeuronPack.hpp"
+#include "NeuronIO.hpp"
+#include "Logging.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// C-based includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char PACK_MAGIC[4] = { 'N', 'B', 'P', '1' };
+static constexpr uint32_t PACK_VERSION = 1;
+static constexpr size_t PACK_HEADER_SIZE = sizeof(PACK_MAGIC) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+template<typename T>
+static T readAt(const char* data, size_t size, size_t offset, const std::string& filepath) {
+    if (offset + sizeof(T) > size) {
+        throw std::runtime_error("Truncated neuron pack: " + filepath);
+    }
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+// ================= NeuronPack Definitions =================
+
+NeuronPack::NeuronPack(const std::string& filepath) : filepath(filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1) { throw std::runtime_error("Cannot open " + filepath); }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("Cannot stat " + filepath);
+    }
+    dataSize = st.st_size;
+    if (dataSize < PACK_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Not a neuron pack: " + filepath);
+    }
+    void* mapped = mmap(nullptr, dataSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) { throw std::runtime_error("Cannot mmap " + filepath); }
+    data = static_cast<const char*>(mapped);
+
+    try {
+        parseIndex();
+    } catch (...) {
+        munmap(const_cast<char*>(data), dataSize);
+        throw;
+    }
+    LOG_DEBUG("mapped neuron pack \"%s\": %zu neurons", filepath.c_str(), neuronIDs.size());
+}
+
+void NeuronPack::parseIndex() {
+    if (std::memcmp(data, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0) {
+        throw std::runtime_error("Not a neuron pack: " + filepath);
+    }
+    size_t pos = sizeof(PACK_MAGIC);
+    uint32_t version = readAt<uint32_t>(data, dataSize, pos, filepath);
+    pos += sizeof(uint32_t);
+    uint64_t count = readAt<uint64_t>(data, dataSize, pos, filepath);
+    pos += sizeof(uint64_t);
+    uint64_t indexOffset = readAt<uint64_t>(data, dataSize, pos, filepath);
+    if (version != PACK_VERSION) {
+        throw std::runtime_error("Unsupported neuron pack version in " + filepath);
+    }
+
+    neuronIDs.reserve(count);
+    index.reserve(count);
+    pos = indexOffset;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t recordOffset = readAt<uint64_t>(data, dataSize, pos, filepath);
+        uint64_t recordSize = readAt<uint64_t>(data, dataSize, pos + 8, filepath);
+        uint32_t idLength = readAt<uint32_t>(data, dataSize, pos + 16, filepath);
+        pos += 20;
+        if (pos + idLength > dataSize || recordOffset + recordSize > indexOffset) {
+            throw std::runtime_error("Corrupt neuron pack index: " + filepath);
+        }
+        neuronIDs.emplace_back(data + pos, idLength);
+        index.emplace(neuronIDs.back(), std::make_pair(recordOffset, recordSize));
+        pos += idLength;
+    }
+}
+
+NeuronPack::~NeuronPack() {
+    if (data) {
+        munmap(const_cast<char*>(data), dataSize);
+    }
+}
+
+bool NeuronPack::contains(const std::string& neuronID) const {
+    return index.find(neuronID) != index.end();
+}
+
+Neuron NeuronPack::load(const std::string& neuronID) const {
+    auto it = index.find(neuronID);
+    if (it == index.end()) {
+        throw std::runtime_error("Neuron " + neuronID + " not in pack " + filepath);
+    }
+    auto [offset, size] = it->second;
+    return NeuronIO::decode(data + offset, size, filepath + ":" + neuronID);
+}
+
+// ================= NeuronPackWriter Definitions =================
+
+NeuronPackWriter::NeuronPackWriter(const std::string& filepath) 
+    : filepath(filepath), 
+    fout(filepath, std::ios::binary | std::ios::trunc), 
+    offset(PACK_HEADER_SIZE) {
+    if (!fout) { throw std::runtime_error("Cannot open " + filepath); }
+    // header is rewritten by finish() once the index offset is known
+    std::string header(PACK_HEADER_SIZE, '\0');
+    fout.write(header.data(), header.size());
+}
+
+void NeuronPackWriter::append(const std::string& neuronID, const Neuron& neuron) {
+    buffer.clear();
+    NeuronIO::encode(neuron, buffer);
+    fout.write(buffer.data(), buffer.size());
+    entries.push_back(IndexEntry{ neuronID, offset, buffer.size() });
+    offset += buffer.size();
+}
+
+void NeuronPackWriter::finish() {
+    for (const auto& entry : entries) {
+        uint32_t idLength = entry.neuronID.size();
+        fout.write(reinterpret_cast<const char*>(&entry.offset), sizeof(uint64_t));
+        fout.write(reinterpret_cast<const char*>(&entry.size), sizeof(uint64_t));
+        fout.write(reinterpret_cast<const char*>(&idLength), sizeof(uint32_t));
+        fout.write(entry.neuronID.data(), idLength);
+    }
+    uint64_t count = entries.size();
+    fout.seekp(0);
+    fout.write(PACK_MAGIC, sizeof(PACK_MAGIC));
+    fout.write(reinterpret_cast<const char*>(&PACK_VERSION), sizeof(uint32_t));
+    fout.write(reinterpret_cast<const char*>(&count), sizeof(uint64_t));
+    fout.write(reinterpret_cast<const char*>(&offset), sizeof(uint64_t));
+    fout.close();
+    if (!fout) { throw std::runtime_error("Failed writing " + filepath); }
+}
@@ -0,0 +1,73 @@
+#ifndef NEURON_PACK_HPP
+#define NEURON_PACK_HPP
+
+#include "Neuron.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+constexpr const char *NEURON_PACK_EXT = ".nbp";
+
+// Dataset pack (.nbp) layout, host byte order:
+//   char[4]  magic "NBP1"
+//   uint32   version
+//   uint64   number of neurons n
+//   uint64   byte offset of the index
+//   n binary neuron records (see NeuronIO), back to back
+//   index, n entries of:
+//     uint64  record offset
+//     uint64  record size
+//     uint32  id length
+//     char[]  neuron id
+//
+// A pack is opened with mmap, so looking a neuron up costs no file
+// open or read call. Records are still decoded into a fresh Neuron (and
+// its KD-tree cloud), not referenced in place: they are stored in double
+// precision for both builds, and a Neuron owns its points.
+class NeuronPack {
+    public:
+        explicit NeuronPack(const std::string& filepath);
+        ~NeuronPack();
+        NeuronPack(const NeuronPack&) = delete;
+        NeuronPack& operator=(const NeuronPack&) = delete;
+
+        bool contains(const std::string& neuronID) const;
+        Neuron load(const std::string& neuronID) const;
+        inline const std::vector<std::string>& getNeuronIDs() const { return neuronIDs; }
+        inline size_t size() const { return neuronIDs.size(); }
+    private:
+        std::string filepath;
+        const char* data = nullptr;
+        size_t dataSize = 0;
+        std::vector<std::string> neuronIDs;
+        std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> index;
+
+        void parseIndex();
+};
+
+// Streams neurons into a new pack, the index is written by finish().
+class NeuronPackWriter {
+    public:
+        explicit NeuronPackWriter(const std::string& filepath);
+
+        void append(const std::string& neuronID, const Neuron& neuron);
+        void finish();
+    private:
+        struct IndexEntry {
+            std::string neuronID;
+            uint64_t offset;
+            uint64_t size;
+        };
+        std::string filepath;
+        std::ofstream fout;
+        uint64_t offset;
+        std::vector<IndexEntry> entries;
+        std::string buffer;
+};
+
+#endif // NEURON_PACK_HPP
@@ -0,0 +1,70 @@
+#include "NeuronStore.hpp"
+#include "Scoring.hpp"
+#include "StringUtils.hpp"
+#include "Logging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+void NeuronStore::preload(const Dataset& dataset, const StringVector& neuronIDs, ThreadPool& pool) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::vector<std::shared_ptr<const Neuron>> loaded(neuronIDs.size());
+    std::atomic<size_t> done{0};
+    std::mutex progressMutex;
+    // report roughly every 10%
+    size_t step = std::max<size_t>(neuronIDs.size() / 10, 1);
+    std::atomic<size_t> reported{0};
+
+    parallelFor(pool, neuronIDs.size(), [&](size_t i) {
+        Neuron n = dataset.load(neuronIDs[i]);
+        if (mat) {
+            ensureSelfScore(n, *mat, doSine);
+        }
+        loaded[i] = std::make_shared<const Neuron>(std::move(n));
+
+        if (++done < reported + step && done < neuronIDs.size()) return;
+        std::lock_guard<std::mutex> lock(progressMutex);
+        size_t count = done;
+        if (count > reported && (count >= reported + step || count == neuronIDs.size())) {
+            reported = count;
+            std::cerr << "preload " << dataset.getPath() << ": " 
+                      << count << "/" << neuronIDs.size() << " neurons (" 
+                      << elapsed() << "s)\n";
+        }
+    });
+
+    neurons.reserve(neurons.size() + neuronIDs.size());
+    for (size_t i = 0; i < neuronIDs.size(); ++i) {
+        sizeBytes += neuronBytes(*loaded[i]);
+        neurons[filenameToPath(dataset.getPath(), neuronIDs[i])] = std::move(loaded[i]);
+    }
+    preloadSeconds += elapsed();
+    LOG_INFO("preloaded %zu neurons from \"%s\" in %fs", neuronIDs.size(), dataset.getPath().c_str(), elapsed());
+}
+
+std::shared_ptr<const Neuron> NeuronStore::find(const Dataset& dataset, const std::string& neuronID) const {
+    auto it = neurons.find(filenameToPath(dataset.getPath(), neuronID));
+    if (it == neurons.end()) {
+        throw std::runtime_error("Neuron " + neuronID + " was not preloaded from " + dataset.getPath());
+    }
+    return it->second;
+}
+
+std::shared_ptr<const Neuron> NeuronStore::get(const Dataset& dataset, const std::string& neuronID) {
+    return find(dataset, neuronID);
+}
+
+void NeuronStore::print(std::ostream& out) const {
+    out << "Preloaded Neurons: " << neurons.size() << "\n";
+    out << "Preloaded Bytes: " << sizeBytes << "\n";
+    out << "Preload Time: " << preloadSeconds << "\n";
+}
@@ -0,0 +1,38 @@
+#ifndef NEURON_STORE_HPP
+#define NEURON_STORE_HPP
+
+#include "Dataset.hpp"
+#include "Matrix.hpp"
+#include "Neuron.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// Immutable set of neurons loaded up front, keyed like NeuronCache.
+// Once preloading is done lookups take no lock, so any number of
+// threads may read from it.
+class NeuronStore : public NeuronSource {
+    public:
+        NeuronStore(const Matrix* mat = nullptr, bool doSine = false) : mat(mat), doSine(doSine) {}
+
+        // loads every listed neuron of the dataset on the pool
+        void preload(const Dataset& dataset, const StringVector& neuronIDs, ThreadPool& pool);
+
+        std::shared_ptr<const Neuron> get(const Dataset& dataset, const std::string& neuronID) override;
+        std::shared_ptr<const Neuron> find(const Dataset& dataset, const std::string& neuronID) const;
+
+        inline size_t getCount() const { return neurons.size(); }
+        void print(std::ostream& out) const override;
+    private:
+        const Matrix* mat;
+        bool doSine;
+        std::unordered_map<std::string, std::shared_ptr<const Neuron>> neurons;
+        uint64_t sizeBytes = 0;
+        double preloadSeconds = 0.0;
+};
+
+#endif // NEURON_STORE_HPP
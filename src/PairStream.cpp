@@ -0,0 +1,25 @@
+#include "PairStream.hpp"
+
+#include <string>
+#include <utility>
+
+bool PairStream::readPair() {
+    std::string queryNeuronID, targetNeuronID;
+    if (!(in >> queryNeuronID >> targetNeuronID)) return false;
+    if (lookahead) {
+        source.prefetch(queryDataset, queryNeuronID);
+        source.prefetch(targetDataset, targetNeuronID);
+    }
+    pending.emplace_back(std::move(queryNeuronID), std::move(targetNeuronID));
+    return true;
+}
+
+bool PairStream::next(std::string& queryNeuronID, std::string& targetNeuronID) {
+    // the pair handed out now plus lookahead pairs behind it
+    while (pending.size() <= lookahead && readPair()) {}
+    if (pending.empty()) return false;
+    queryNeuronID = std::move(pending.front().first);
+    targetNeuronID = std::move(pending.front().second);
+    pending.pop_front();
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef PAIR_STREAM_HPP
+#define PAIR_STREAM_HPP
+
+#include "Dataset.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <string>
+#include <utility>
+
+// Reads whitespace separated "queryID targetID" pairs from a stream,
+// keeping up to lookahead pairs read ahead of the caller. Each pair is
+// handed to the neuron source as a prefetch hint when it is read, so
+// its neurons are loading while earlier pairs are being scored.
+class PairStream {
+    public:
+        PairStream(std::istream& in, 
+                   NeuronSource& source, 
+                   const Dataset& queryDataset, 
+                   const Dataset& targetDataset, 
+                   size_t lookahead)
+            : in(in), source(source), queryDataset(queryDataset), 
+              targetDataset(targetDataset), lookahead(lookahead) {}
+
+        // next pair in input order, false once the input is exhausted
+        bool next(std::string& queryNeuronID, std::string& targetNeuronID);
+    private:
+        std::istream& in;
+        NeuronSource& source;
+        const Dataset& queryDataset;
+        const Dataset& targetDataset;
+        size_t lookahead;
+        std::deque<std::pair<std::string, std::string>> pending;
+
+        bool readPair();
+};
+
+#endif // PAIR_STREAM_HPP
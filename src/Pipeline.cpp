@@ -6,44 +6,53 @@
 #include "Logging.hpp"
 #include "Point.hpp"
 #include "Scoring.hpp"
+#include "Neuron.hpp"
+#include "Dataset.hpp"
+#include "NeuronIndex.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <vector>
 
 double query(const Args& a, 
              const Matrix& mat, 
+             NeuronSource& source,
+             const Dataset& queryDataset, 
+             const Dataset& targetDataset, 
              const std::string& queryNeuronID, 
              const std::string& targetNeuronID) {
-    std::string queryFilepath = filenameToPath(a.queryDatasetFilepath, queryNeuronID, ".swc");
-    std::string strippedQuery;
-    basenameNoExt(queryFilepath, strippedQuery);
-    LOG_DEBUG("Query Filepath: \"%s\"", queryFilepath.c_str());
-    PointVector queryVector = loadPoints(queryFilepath);
-
-    std::string targetFilepath = filenameToPath(a.targetDatasetFilepath, targetNeuronID, ".swc");
-    std::string strippedTarget;
-    basenameNoExt(targetFilepath, strippedTarget);
-    LOG_DEBUG("Target Filepath: \"%s\"", targetFilepath.c_str());
-    PointVector targetVector = loadPoints(targetFilepath);
-
-    return scoreNeuronPair(mat, queryVector, targetVector, a.doSine);
+    LOG_DEBUG("Query Neuron: \"%s\"", queryNeuronID.c_str());
+    auto queryNeuron = source.get(queryDataset, queryNeuronID);
+
+    LOG_DEBUG("Target Neuron: \"%s\"", targetNeuronID.c_str());
+    auto targetNeuron = source.get(targetDataset, targetNeuronID);
+
+    return scoreNeuronPair(mat, *queryNeuron, *targetNeuron, a.doSine);
 }
 
 void trainMatrixStep(const Args a, 
-                     const StringVector& queryFilepathVector, 
-                     const StringVector& targetFilepathVector, 
+                     NeuronSource& source, 
+                     const Dataset& queryDataset, 
+                     const StringVector& queryIDVector, 
+                     const Dataset& targetDataset, 
+                     const StringVector& targetIDVector, 
                      Matrix& mat) {
-    uint64_t k = queryFilepathVector.size() * drand48();
-    uint64_t l = targetFilepathVector.size() * drand48();
+    uint64_t k = queryIDVector.size() * drand48();
+    uint64_t l = targetIDVector.size() * drand48();
     
-    std::string queryFilepath = queryFilepathVector[k];
-    LOG_DEBUG("query filepath: %s", queryFilepath.c_str());
-    PointVector queryPointVector = loadPoints(queryFilepath);
+    const std::string& queryNeuronID = queryIDVector[k];
+    LOG_DEBUG("query neuron: %s", queryNeuronID.c_str());
+    auto queryNeuron = source.get(queryDataset, queryNeuronID);
 
-    std::string targetFilepath = targetFilepathVector[l];
-    LOG_DEBUG("target filepath: %s", targetFilepath.c_str());
-    PointVector targetPointVector = loadPoints(targetFilepath);
+    const std::string& targetNeuronID = targetIDVector[l];
+    LOG_DEBUG("target neuron: %s", targetNeuronID.c_str());
+    auto targetNeuron = source.get(targetDataset, targetNeuronID);
 
-    PAVector matchVector = nearestNeighborKDTree(queryPointVector, targetPointVector, a.doSine);
+    PAVector matchVector = nearestNeighborKDTree(*queryNeuron, *targetNeuron, a.doSine);
     for (const auto& match : matchVector) {
         if (match.queryPointID != -1 || match.targetPointID != -1) {
             mat.increment(match.distance, match.angleMeasure);
@@ -51,11 +60,163 @@ void trainMatrixStep(const Args a,
    }
 }
 
+// all-by-all scores of already loaded neurons, see allByAll()
+static DoubleVector allByAllNeurons(const Matrix& mat, 
+                                   const std::vector<std::shared_ptr<const Neuron>>& neurons, 
+                                   bool doSine, 
+                                   ThreadPool& pool) {
+    const size_t n = neurons.size();
+    // raw[i * n + j] = directional score of neuron i matched against neuron j.
+    // Both directions of a pair are filled by one of its two tasks, chosen
+    // by parity so that every row of tasks keeps about half of its work.
+    DoubleVector raw(n * n);
+    parallelFor(pool, n * n, [&](size_t k) {
+        size_t i = k / n, j = k % n;
+        if (i == j) {
+            raw[k] = neurons[i]->selfScore;
+        } else if ((i < j) == ((i + j) % 2 == 1)) {
+            pairRawScores(mat, *neurons[i], *neurons[j], doSine, raw[k], raw[j * n + i]);
+        }
+    });
+
+    DoubleVector scores(n * n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i; j < n; ++j) {
+            double score = pairScore(raw[i * n + j], raw[j * n + i], *neurons[i], *neurons[j]);
+            scores[i * n + j] = score;
+            scores[j * n + i] = score;
+        }
+    }
+    return scores;
+}
+
+static std::vector<std::shared_ptr<const Neuron>> getNeurons(NeuronSource& source, 
+                                                             const Dataset& dataset, 
+                                                             const StringVector& neuronIDVector) {
+    std::vector<std::shared_ptr<const Neuron>> neurons;
+    neurons.reserve(neuronIDVector.size());
+    for (const auto& neuronID : neuronIDVector) {
+        neurons.push_back(source.get(dataset, neuronID));
+    }
+    return neurons;
+}
+
+DoubleVector allByAll(const Matrix& mat, 
+                      NeuronSource& source, 
+                      const Dataset& dataset, 
+                      const StringVector& neuronIDVector, 
+                      bool doSine, 
+                      ThreadPool& pool) {
+    return allByAllNeurons(mat, getNeurons(source, dataset, neuronIDVector), doSine, pool);
+}
+
+DoubleVector allByAllCoarseToFine(const Matrix& mat, 
+                                  NeuronSource& source, 
+                                  const Dataset& dataset, 
+                                  const StringVector& neuronIDVector, 
+                                  double coarseStep, 
+                                  double rescoreFraction, 
+                                  bool doSine, 
+                                  ThreadPool& pool, 
+                                  size_t& rescored) {
+    const size_t n = neuronIDVector.size();
+    auto neurons = getNeurons(source, dataset, neuronIDVector);
+    std::vector<std::shared_ptr<const Neuron>> coarse(n);
+    parallelFor(pool, n, [&](size_t i) {
+        Neuron c = coarsenNeuron(*neurons[i], coarseStep);
+        c.selfScore = selfScore(mat, c, doSine);
+        ensureIndex(c);
+        coarse[i] = std::make_shared<const Neuron>(std::move(c));
+    });
+    DoubleVector scores = allByAllNeurons(mat, coarse, doSine, pool);
+
+    // the best-ranked pairs i < j, rescored at full resolution
+    std::vector<std::pair<size_t, size_t>> pairs;
+    pairs.reserve(n ? n * (n - 1) / 2 : 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n; ++j) pairs.emplace_back(i, j);
+    }
+    rescored = std::min(pairs.size(), static_cast<size_t>(std::ceil(rescoreFraction * pairs.size())));
+    std::stable_sort(pairs.begin(), pairs.end(), [&](const auto& a, const auto& b) {
+        return scores[a.first * n + a.second] > scores[b.first * n + b.second];
+    });
+    // coarse scores are on another scale, so only exact ones are kept
+    DoubleVector exact(n * n, std::numeric_limits<double>::quiet_NaN());
+    parallelFor(pool, rescored, [&](size_t p) {
+        auto [i, j] = pairs[p];
+        double score = scoreNeuronPair(mat, *neurons[i], *neurons[j], doSine);
+        exact[i * n + j] = score;
+        exact[j * n + i] = score;
+    });
+    for (size_t i = 0; i < n; ++i) {
+        exact[i * n + i] = pairScore(neurons[i]->selfScore, neurons[i]->selfScore, *neurons[i], *neurons[i]);
+    }
+    return exact;
+}
+
+std::vector<std::pair<std::string, double>> topTargets(const Matrix& mat, 
+                                                       NeuronSource& source, 
+                                                       const Dataset& queryDataset, 
+                                                       const std::string& queryNeuronID, 
+                                                       const Dataset& targetDataset, 
+                                                       const StringVector& targetIDVector, 
+                                                       size_t k, 
+                                                       bool doSine, 
+                                                       ThreadPool& pool, 
+                                                       size_t& scored) {
+    auto queryNeuron = source.get(queryDataset, queryNeuronID);
+    const size_t n = targetIDVector.size();
+    std::vector<std::shared_ptr<const Neuron>> targets(n);
+    DoubleVector bounds(n);
+    ScoreBound bound(mat);
+    parallelFor(pool, n, [&](size_t i) {
+        targets[i] = source.get(targetDataset, targetIDVector[i]);
+        bounds[i] = bound.pair(*queryNeuron, *targets[i]);
+    });
+    std::vector<size_t> candidates(n);
+    std::iota(candidates.begin(), candidates.end(), 0);
+    std::stable_sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return bounds[a] > bounds[b]; });
+
+    // best k so far as (score, target index), a heap with the worst in front
+    auto better = [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    };
+    std::vector<std::pair<double, size_t>> best;
+    DoubleVector scores(n);
+    const size_t batch = pool.size();
+    scored = 0;
+    while (scored < n && k > 0) {
+        if (best.size() == k && best.front().first > bounds[candidates[scored]]) break;
+        size_t end = std::min(n, scored + batch);
+        parallelFor(pool, end - scored, [&](size_t c) {
+            size_t i = candidates[scored + c];
+            scores[i] = scoreNeuronPair(mat, *queryNeuron, *targets[i], doSine);
+        });
+        for (; scored < end; ++scored) {
+            size_t i = candidates[scored];
+            best.emplace_back(scores[i], i);
+            std::push_heap(best.begin(), best.end(), better);
+            if (best.size() > k) {
+                std::pop_heap(best.begin(), best.end(), better);
+                best.pop_back();
+            }
+        }
+    }
+
+    std::sort(best.begin(), best.end(), better);
+    std::vector<std::pair<std::string, double>> hits;
+    for (const auto& [score, i] : best) hits.emplace_back(targetIDVector[i], score);
+    return hits;
+}
+
 std::pair<DoubleVector, DoubleVector> generateBins(
-    StringVector queryFilepathVector, 
-    StringVector targetFilepathVector, 
-    StringVector knownMatchesQueryVector, 
-    StringVector knownMatchesTargetVector,
+    NeuronSource& source, 
+    const Dataset& queryDataset, 
+    const StringVector& queryIDVector, 
+    const Dataset& targetDataset, 
+    const StringVector& targetIDVector, 
+    const StringVector& knownMatchesQueryVector, 
+    const StringVector& knownMatchesTargetVector,
     unsigned numDistanceBins,
     unsigned numIters
 ) {
@@ -68,32 +229,33 @@ std::pair<DoubleVector, DoubleVector> generateBins(
     DoubleVector angleBins;
     PAVector samples;
     for (unsigned i = 0; i < numIters; ++i) {
-        uint64_t k = queryFilepathVector.size() * drand48();
-        uint64_t l = targetFilepathVector.size() * drand48();
+        uint64_t k = queryIDVector.size() * drand48();
+        uint64_t l = targetIDVector.size() * drand48();
 
-        std::string queryFilepath = queryFilepathVector[k];
-        LOG_DEBUG("query filepath: %s", queryFilepath.c_str());
-        PointVector queryPointVector = loadPoints(queryFilepath);
+        const std::string& queryNeuronID = queryIDVector[k];
+        LOG_DEBUG("query neuron: %s", queryNeuronID.c_str());
+        auto queryNeuron = source.get(queryDataset, queryNeuronID);
 
-        std::string targetFilepath = targetFilepathVector[l];
-        LOG_DEBUG("target filepath: %s", targetFilepath.c_str());
-        PointVector targetPointVector = loadPoints(targetFilepath);
+        const std::string& targetNeuronID = targetIDVector[l];
+        LOG_DEBUG("target neuron: %s", targetNeuronID.c_str());
+        auto targetNeuron = source.get(targetDataset, targetNeuronID);
     
-        PAVector matchVector = nearestNeighborKDTree(queryPointVector, targetPointVector, false);
+        PAVector matchVector = nearestNeighborKDTree(*queryNeuron, *targetNeuron, false);
         samples.insert(samples.end(), matchVector.begin(), matchVector.end());
         
         uint64_t j = knownMatchesQueryVector.size() * drand48();
         uint64_t b = knownMatchesTargetVector.size() * drand48();
 
-        std::string knownMatchesQueryFilepath = knownMatchesQueryVector[j];
-        LOG_DEBUG("query filepath: %s", knownMatchesQueryFilepath.c_str());
-        PointVector knownMatchesQueryPointVector = loadPoints(knownMatchesQueryFilepath);
+        // known matches are resolved in the query dataset
+        const std::string& knownMatchesQueryNeuronID = knownMatchesQueryVector[j];
+        LOG_DEBUG("query neuron: %s", knownMatchesQueryNeuronID.c_str());
+        auto knownMatchesQueryNeuron = source.get(queryDataset, knownMatchesQueryNeuronID);
 
-        std::string knownMatchesTargetFilepath = knownMatchesTargetVector[b];
-        LOG_DEBUG("target filepath: %s", knownMatchesTargetFilepath.c_str());
-        PointVector knownMatchesTargetPointVector = loadPoints(knownMatchesTargetFilepath);
+        const std::string& knownMatchesTargetNeuronID = knownMatchesTargetVector[b];
+        LOG_DEBUG("target neuron: %s", knownMatchesTargetNeuronID.c_str());
+        auto knownMatchesTargetNeuron = source.get(queryDataset, knownMatchesTargetNeuronID);
     
-        PAVector knownMatchVector = nearestNeighborKDTree(knownMatchesQueryPointVector, knownMatchesTargetPointVector, false);
+        PAVector knownMatchVector = nearestNeighborKDTree(*knownMatchesQueryNeuron, *knownMatchesTargetNeuron, false);
         samples.insert(samples.end(), knownMatchVector.begin(), knownMatchVector.end());
        
     }
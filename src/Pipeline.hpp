@@ -8,24 +8,79 @@
 #include "Logging.hpp"
 #include "Point.hpp"
 #include "Scoring.hpp"
+#include "Dataset.hpp"
+#include "ThreadPool.hpp"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 double query(const Args& a, 
              const Matrix& mat, 
+             NeuronSource& source,
+             const Dataset& queryDataset, 
+             const Dataset& targetDataset, 
              const std::string& queryNeuronID, 
              const std::string& targetNeuronID);
              
 void trainMatrixStep(const Args a, 
-                     const StringVector& queryFilepathVector, 
-                     const StringVector& targetFilepathVector, 
+                     NeuronSource& source, 
+                     const Dataset& queryDataset, 
+                     const StringVector& queryIDVector, 
+                     const Dataset& targetDataset, 
+                     const StringVector& targetIDVector, 
                      Matrix& mat);
 using DoubleVector = std::vector<double>;
+
+// Scores every pair of the given neurons of one dataset. Pair (i, j) and
+// pair (j, i) share both directional raw scores, so each one is computed
+// exactly once. Returns the symmetric n x n score matrix, row-major.
+DoubleVector allByAll(const Matrix& mat, 
+                      NeuronSource& source, 
+                      const Dataset& dataset, 
+                      const StringVector& neuronIDVector, 
+                      bool doSine, 
+                      ThreadPool& pool);
+
+// allByAll() ranked at a coarse resolution first: every neuron is reduced
+// to one segment per coarseStep voxel and all pairs are scored that way.
+// The best rescoreFraction of the pairs are then rescored exactly, and
+// rescored is set to how many. Only those and the diagonal hold a score,
+// the rest are NaN.
+DoubleVector allByAllCoarseToFine(const Matrix& mat, 
+                                  NeuronSource& source, 
+                                  const Dataset& dataset, 
+                                  const StringVector& neuronIDVector, 
+                                  double coarseStep, 
+                                  double rescoreFraction, 
+                                  bool doSine, 
+                                  ThreadPool& pool, 
+                                  size_t& rescored);
+
+// The k targets scoring highest against the query, best first, each with
+// its score. Targets are taken in descending order of their ScoreBound
+// and scored a batch at a time on the pool, stopping once the k-th best
+// exact score beats the bound of every target left. scored is set to the
+// number of targets scored exactly.
+std::vector<std::pair<std::string, double>> topTargets(const Matrix& mat, 
+                                                       NeuronSource& source, 
+                                                       const Dataset& queryDataset, 
+                                                       const std::string& queryNeuronID, 
+                                                       const Dataset& targetDataset, 
+                                                       const StringVector& targetIDVector, 
+                                                       size_t k, 
+                                                       bool doSine, 
+                                                       ThreadPool& pool, 
+                                                       size_t& scored);
+
 std::pair<DoubleVector, DoubleVector> generateBins(
-    StringVector queryFilepathVector, 
-    StringVector targetFilepathVector, 
-    StringVector knownMatchesQueryVector, 
-    StringVector knownMatchesTargetVector,
+    NeuronSource& source, 
+    const Dataset& queryDataset, 
+    const StringVector& queryIDVector, 
+    const Dataset& targetDataset, 
+    const StringVector& targetIDVector, 
+    const StringVector& knownMatchesQueryVector, 
+    const StringVector& knownMatchesTargetVector,
     unsigned numDistanceBins,
     unsigned numIters
 );
@@ -33,7 +33,7 @@ double Point::angleMeasure(const Point& other, bool do_sine) const {
     if (selfMagnitude == 0 || otherMagnitude == 0) return -1;
     double angleMeasure = std::abs(normedDotProduct(*this, other) / (selfMagnitude * otherMagnitude));
     if(angleMeasure > 1) angleMeasure = 1;
-    if (do_sine) return sin(acos(angleMeasure)); 
+    if (do_sine) return sineFromCosine(angleMeasure);
     else return angleMeasure;
 }
 Point& Point::operator=(const Point& other) {
@@ -48,9 +48,6 @@ Point& Point::operator=(const Point& other) {
     return *this;
 }
 
-double normedDotProduct(const Point& lhs, const Point& rhs) {
-    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
-}
 std::ostream& operator<<(std::ostream& out, const Point& p) {
     out << std::fixed << std::setprecision(4)
         << "id: '" << p.id << "' "
@@ -74,13 +71,6 @@ Point operator*(double lhs, const Point& rhs) {
 }
 
 // ================= PointAlignment Definitions =================
-void PointAlignment::computeRawScore(const Matrix& mat) {
-    if (distance < 0 || angleMeasure < 0) {
-        std::cerr << "Invalid distance or angleMeasure\n";
-        exit(EXIT_FAILURE);
-    }
-    this->score = mat.score(distance, angleMeasure);
-}
 void PointAlignment::printDifference(std::ostream& out, const std::string& tag) const {
     if (tag.size()) {
        out << tag << ": ";
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
 #include <sstream>
 #include <vector>
 #include <string>
@@ -13,13 +14,23 @@
 using DoubleVector = std::vector<double>;
 using DoubleVector2D = std::vector<DoubleVector>;
 
+// Coordinate type of points, search trees and nearest-neighbour
+// distances. Building with FLOAT32=1 halves their memory traffic, see
+// regression-tests/fctraces20-float32-test.sh for the accuracy cost.
+#ifdef NBLAST_FLOAT32
+using coord_t = float;
+#else
+using coord_t = double;
+#endif
+
 constexpr int POINT_DEFAULT_PARENT = -1;
 constexpr int POINT_DEFAULT_ID = -1;
 
 // Individual points, stores parent, position, etc.
 struct Point {
     int id;
-    double x, y, z;
+    coord_t x, y, z;
+    // index of the parent point in its PointVector, -1 for roots
     int parent;
 
     Point(int id, double x, double y, double z, int parent) 
@@ -37,7 +48,10 @@ struct Point {
 
     Point& operator=(const Point& other);
 
-    friend double normedDotProduct(const Point& lhs, const Point& rhs);
+    // inline, it runs once per match
+    friend inline double normedDotProduct(const Point& lhs, const Point& rhs) {
+        return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+    }
     friend std::ostream& operator<<(std::ostream& out, const Point& p);
     friend Point operator-(const Point& lhs, const Point& rhs);
     friend Point operator+(const Point& lhs, const Point& rhs);
@@ -46,6 +60,12 @@ struct Point {
 };
 using PointVector = std::vector<Point>;
 
+// sine of an angle in [0, pi/2] from its cosine, without the round trip
+// through acos; factored to stay accurate as the cosine nears 1
+inline double sineFromCosine(double cosine) {
+    return std::sqrt((1 - cosine) * (1 + cosine));
+}
+
 // Alignment structure, stores point-ids, distance, etc.
 struct PointAlignment {
     int queryPointID, targetPointID;
@@ -71,7 +91,15 @@ struct PointAlignment {
         angleMeasure(other.angleMeasure),
         score(other.score) {}
 
-    void computeRawScore(const Matrix& mat);
+    // mat is a Matrix or one of its FixedMatrix copies
+    template<typename M>
+    void computeRawScore(const M& mat) {
+        if (distance < 0 || angleMeasure < 0) {
+            std::cerr << "Invalid distance or angleMeasure\n";
+            exit(EXIT_FAILURE);
+        }
+        this->score = mat.score(distance, angleMeasure);
+    }
 
     void printDifference(std::ostream& out, const std::string& tag = "") const;
     void printScore(std::ostream& out) const;
@@ -9,58 +9,258 @@
 #include "StringUtils.hpp"
 #include "Timer.hpp"
 #include "Pipeline.hpp"
+#include "NeuronCache.hpp"
+#include "Neuron.hpp"
+#include "NeuronIO.hpp"
+#include "NeuronPack.hpp"
+#include "Dataset.hpp"
+#include "DatasetIndex.hpp"
+#include "NeuronStore.hpp"
+#include "ThreadPool.hpp"
+#include "PairStream.hpp"
 
+#include <cmath>
+#include <deque>
 #include <iostream>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+
+// Neurons come from an up-front parallel preload of both datasets with
+// -p, otherwise they are loaded lazily through the bounded cache, which
+// loads ahead in the background when query mode reads pairs ahead (-l).
+static std::unique_ptr<NeuronSource> makeNeuronSource(const Args& a, 
+                                                      const Dataset& queryDataset, 
+                                                      const StringVector& queryIDVector, 
+                                                      const Dataset& targetDataset, 
+                                                      const StringVector& targetIDVector, 
+                                                      const Matrix* mat) {
+    if (!a.doPreload) {
+        auto cache = std::make_unique<NeuronCache>(a.cacheCapacityMiB << 20, mat, a.doSine);
+        if (a.mode == option_t::Query && a.lookaheadPairs) {
+            cache->enablePrefetch(a.numThreads ? a.numThreads : defaultThreadCount());
+        }
+        return cache;
+    }
+    ThreadPool pool(a.numThreads ? a.numThreads : defaultThreadCount());
+    auto store = std::make_unique<NeuronStore>(mat, a.doSine);
+    store->preload(queryDataset, queryIDVector, pool);
+    if (targetDataset.getPath() != queryDataset.getPath()) {
+        store->preload(targetDataset, targetIDVector, pool);
+    }
+    return store;
+}
+
+// Scores the pairs produced by nextPair(query, target) on the pool and
+// writes one line per pair in input order. Finished scores wait in a
+// reorder buffer of at most a few pairs per worker until every pair
+// before them has been written.
+template<typename NextPair>
+static void scorePairsInOrder(const Args& a, 
+                              const Matrix& mat, 
+                              NeuronSource& source, 
+                              const Dataset& queryDataset, 
+                              const Dataset& targetDataset, 
+                              NextPair nextPair, 
+                              ThreadPool& pool, 
+                              TimerStats& ts) {
+    struct PendingPair {
+        std::string queryNeuronID;
+        std::string targetNeuronID;
+        // score and seconds spent scoring
+        std::future<std::pair<double, double>> result;
+    };
+    std::deque<PendingPair> reorderBuffer;
+    const size_t maxInFlight = pool.size() * 4;
+
+    auto writeOldest = [&]() {
+        PendingPair& oldest = reorderBuffer.front();
+        auto [score, seconds] = oldest.result.get();
+        ts.addSample(seconds);
+        std::cout << oldest.queryNeuronID << "\t" 
+                << oldest.targetNeuronID << "\t" 
+                << score << "\n";
+        reorderBuffer.pop_front();
+    };
+
+    std::string queryNeuronID, targetNeuronID;
+    try {
+        while (nextPair(queryNeuronID, targetNeuronID)) {
+            if (reorderBuffer.size() >= maxInFlight) writeOldest();
+            auto result = pool.submit([&, queryNeuronID, targetNeuronID]() {
+                TimerStats pairTime;
+                double score = timeFunction(pairTime, [&](){ 
+                    return query(a, mat, source, queryDataset, targetDataset, queryNeuronID, targetNeuronID); 
+                });
+                return std::make_pair(score, pairTime.getTotal());
+            });
+            reorderBuffer.push_back(PendingPair{ queryNeuronID, targetNeuronID, std::move(result) });
+        }
+        while (!reorderBuffer.empty()) writeOldest();
+    } catch (...) {
+        // pairs still in flight refer to this frame
+        for (auto& pending : reorderBuffer) {
+            if (pending.result.valid()) pending.result.wait();
+        }
+        throw;
+    }
+}
+
+// Scores each query listed on the command line against its candidate
+// targets: every target of the dataset, or with -x the ones its spatial
+// index finds near the query. With -k only the a.topK best are written.
+static void runListedQueries(const Args& a, 
+                             const Matrix& mat, 
+                             const Dataset& queryDataset, 
+                             const Dataset& targetDataset) {
+    std::unique_ptr<DatasetIndex> index;
+    StringVector targetIDVector;
+    if (a.useDatasetIndex) {
+        std::string indexPath = DatasetIndex::pathFor(targetDataset.getPath());
+        if (!std::filesystem::exists(indexPath)) {
+            throw std::runtime_error("No spatial index " + indexPath + ", convert the dataset with -b to write one");
+        }
+        index = std::make_unique<DatasetIndex>(DatasetIndex::read(indexPath));
+        // a target it leaves out must not be able to score above zero
+        if (index->getMatrixFingerprint() != mat.fingerprint()) {
+            throw std::runtime_error("Spatial index " + indexPath + " was built for another scoring matrix, "
+                                     "convert the dataset again with " + a.matrixFilepath);
+        }
+        if (ScoreBound(mat).positiveReach() > index->getReach()) {
+            throw std::runtime_error("Spatial index " + indexPath + " only finds targets within " 
+                                     + std::to_string(index->getReach()) + " of a query, " + a.matrixFilepath 
+                                     + " scores matches above zero further out");
+        }
+    } else {
+        targetIDVector = targetDataset.listNeuronIDs();
+    }
+    ThreadPool pool(a.numThreads ? a.numThreads : defaultThreadCount());
+    std::unique_ptr<NeuronSource> source;
+    if (index) {
+        // only the candidates are loaded, as they are asked for
+        source = std::make_unique<NeuronCache>(a.cacheCapacityMiB << 20, &mat, a.doSine);
+    } else {
+        // every target is a candidate for every query, so all are loaded up front
+        auto store = std::make_unique<NeuronStore>(&mat, a.doSine);
+        store->preload(targetDataset, targetIDVector, pool);
+        if (queryDataset.getPath() != targetDataset.getPath()) {
+            store->preload(queryDataset, a.positionalArgs, pool);
+        }
+        source = std::move(store);
+    }
+
+    for (const auto& queryNeuronID : a.positionalArgs) {
+        const StringVector candidates = index ? index->overlapping(*source->get(queryDataset, queryNeuronID)) 
+                                              : targetIDVector;
+        const size_t numTargets = index ? index->size() : targetIDVector.size();
+        if (!a.topK) {
+            size_t next = 0;
+            TimerStats ts;
+            scorePairsInOrder(a, mat, *source, queryDataset, targetDataset, 
+                [&](std::string& pairQueryID, std::string& targetNeuronID) {
+                    if (next >= candidates.size()) return false;
+                    pairQueryID = queryNeuronID;
+                    targetNeuronID = candidates[next++];
+                    return true;
+                }, pool, ts);
+            std::cerr << queryNeuronID << ": " << candidates.size() << " of " << numTargets << " targets near\n";
+            continue;
+        }
+        size_t scored = 0;
+        auto hits = topTargets(mat, *source, queryDataset, queryNeuronID, targetDataset, candidates, 
+                               a.topK, a.doSine, pool, scored);
+        for (const auto& [targetNeuronID, score] : hits) {
+            std::cout << queryNeuronID << "\t" << targetNeuronID << "\t" << score << "\n";
+        }
+        std::cerr << "top-" << a.topK << ": " << queryNeuronID << " scored against " << scored 
+                  << " of " << numTargets << " targets\n";
+    }
+    std::cout.flush();
+}
+
+// true if -f changes scores, which it does unless the last row is the
+// same for every angle anyway
+static bool farMatchesApproximated(const Args& a, const Matrix& mat) {
+    return a.capFarMatches && !mat.lastRowIsConstant();
+}
+
+// scores under -f are approximate, so every run using it says so
+static void reportFarMatchCap(const Args& a, const Matrix& mat) {
+    if (!farMatchesApproximated(a, mat)) return;
+    std::cerr << "-f: matches beyond " << mat.maxDistance() << " score " << mat.farScore() 
+              << ", scores are approximate\n";
+}
 
 void runQueryMode(const Args& a) {
     LOG_INFO("Using Scoring Matrix: \"%s\"", a.matrixFilepath.c_str());
         
     Matrix mat = MatrixIO::loadMatrixFromTSV(a.matrixFilepath);
-    std::string queryNeuronID, targetNeuronID;
+    mat.setCapFarMatches(a.capFarMatches);
+    reportFarMatchCap(a, mat);
+    Dataset queryDataset(a.queryDatasetFilepath, a.resampleStep);
+    Dataset targetDataset(a.targetDatasetFilepath, a.resampleStep);
+    if (a.topK || a.useDatasetIndex) {
+        runListedQueries(a, mat, queryDataset, targetDataset);
+        return;
+    }
+    StringVector queryIDVector, targetIDVector;
+    if (a.doPreload) {
+        queryIDVector = queryDataset.listNeuronIDs();
+        targetIDVector = targetDataset.listNeuronIDs();
+    }
+    auto source = makeNeuronSource(a, queryDataset, queryIDVector, targetDataset, targetIDVector, &mat);
+    ThreadPool pool(a.numThreads ? a.numThreads : defaultThreadCount());
     TimerStats ts;
     if (a.positionalArgs.empty()) {
-        while (std::cin >> queryNeuronID >> targetNeuronID) {
-            double score = timeFunction(ts, [&](){ 
-                return query(a, mat, queryNeuronID, targetNeuronID); 
-            });
-            std::cout << queryNeuronID << "\t" 
-                    << targetNeuronID << "\t" 
-                    << score << "\n";
-        }
+        PairStream pairs(std::cin, *source, queryDataset, targetDataset, a.lookaheadPairs);
+        scorePairsInOrder(a, mat, *source, queryDataset, targetDataset, 
+            [&](std::string& queryNeuronID, std::string& targetNeuronID) {
+                return pairs.next(queryNeuronID, targetNeuronID);
+            }, pool, ts);
         std::ofstream tout("query-times.txt");
         ts.print(tout);
+        tout << "Out Of Reach Pairs: " << outOfReachPairCount() << "\n";
+        tout << "Approximate Far Matches (-f): " << (farMatchesApproximated(a, mat) ? "yes" : "no") << "\n";
+        source->print(tout);
         tout.close();
         return;
     }
-    queryNeuronID = a.positionalArgs[0];
-    for (size_t i = 1; i < a.positionalArgs.size(); i++) {
-        targetNeuronID = a.positionalArgs[i];
-
-        double score = query(a, mat, queryNeuronID, targetNeuronID);
-
-        std::cout << queryNeuronID << "\t" 
-                    << targetNeuronID << "\t" 
-                    << score << "\n";
-    }
+    size_t next = 1;
+    scorePairsInOrder(a, mat, *source, queryDataset, targetDataset, 
+        [&](std::string& queryNeuronID, std::string& targetNeuronID) {
+            if (next >= a.positionalArgs.size()) return false;
+            queryNeuronID = a.positionalArgs[0];
+            targetNeuronID = a.positionalArgs[next++];
+            return true;
+        }, pool, ts);
     std::cout.flush();
 }
 
 void runGeneratorMode(const Args& a) {
-    LOG_DEBUG("grabbing swc filepaths for query dataset...");
-    StringVector queryFilepathVector = getDatasetFilepaths(a.queryDatasetFilepath);
-    LOG_DEBUG("query dataset size: %d", queryFilepathVector.size());
+    LOG_DEBUG("grabbing neuron ids for query dataset...");
+    Dataset queryDataset(a.queryDatasetFilepath, a.resampleStep);
+    StringVector queryIDVector = queryDataset.listNeuronIDs();
+    LOG_DEBUG("query dataset size: %d", queryIDVector.size());
     
-    LOG_DEBUG("grabbing swc filepaths for target dataset...");
-    StringVector targetFilepathVector = getDatasetFilepaths(a.targetDatasetFilepath);
-    LOG_DEBUG("target dataset size: %d", targetFilepathVector.size());
+    LOG_DEBUG("grabbing neuron ids for target dataset...");
+    Dataset targetDataset(a.targetDatasetFilepath, a.resampleStep);
+    StringVector targetIDVector = targetDataset.listNeuronIDs();
+    LOG_DEBUG("target dataset size: %d", targetIDVector.size());
+
+    auto source = makeNeuronSource(a, queryDataset, queryIDVector, targetDataset, targetIDVector, nullptr);
 
-    LOG_DEBUG("getting known matches filepaths from %s", a.knownMatchesFilepath.c_str());
-    auto [knownMatchesQueryVector, knownMatchesTargetVector] = getKnownMatchesFilepaths(a);
+    LOG_DEBUG("getting known matches from %s", a.knownMatchesFilepath.c_str());
+    auto [knownMatchesQueryVector, knownMatchesTargetVector] = getKnownMatchesIDs(a);
     LOG_DEBUG("known matches: query size = %d, target size = %d", 
         knownMatchesQueryVector.size(), knownMatchesQueryVector.size());
     
-    auto [distanceBins, angleBins] = generateBins(queryFilepathVector, 
-                                                  targetFilepathVector, 
+    auto [distanceBins, angleBins] = generateBins(*source, 
+                                                  queryDataset, 
+                                                  queryIDVector, 
+                                                  targetDataset, 
+                                                  targetIDVector, 
                                                   knownMatchesQueryVector, 
                                                   knownMatchesTargetVector, 
                                                   10, 
@@ -76,11 +276,11 @@ void runGeneratorMode(const Args& a) {
         
         // known matches
         LOG_DEBUG("starting known match");
-        trainMatrixStep(a, knownMatchesQueryVector, knownMatchesTargetVector, knownMatrix);
+        trainMatrixStep(a, *source, queryDataset, knownMatchesQueryVector, queryDataset, knownMatchesTargetVector, knownMatrix);
 
         // random matches
         LOG_DEBUG("starting random match");
-        trainMatrixStep(a, queryFilepathVector, targetFilepathVector, randomMatrix);
+        trainMatrixStep(a, *source, queryDataset, queryIDVector, targetDataset, targetIDVector, randomMatrix);
     }
 
     if (a.doDump) {
@@ -110,9 +310,9 @@ void runGeneratorMode(const Args& a) {
     
     Matrix logLikelihoodMatrix(distanceBins, angleBins);
     const double epsilon = 1e-12;
-    for (size_t i = 0; i < logLikelihoodMatrix.getTable().size(); ++i) {
-        for (size_t j = 0; j < logLikelihoodMatrix.getTable()[i].size(); ++j) {
-            logLikelihoodMatrix.getTable()[i][j] = std::log2(knownMatrix.getTable()[i][j] / (randomMatrix.getTable()[i][j] + epsilon));
+    for (size_t i = 0; i < logLikelihoodMatrix.rows(); ++i) {
+        for (size_t j = 0; j < logLikelihoodMatrix.cols(); ++j) {
+            logLikelihoodMatrix.at(i, j) = std::log2(knownMatrix.at(i, j) / (randomMatrix.at(i, j) + epsilon));
         }
     }
     if (!a.matrixOutfile.empty()) {
@@ -125,6 +325,117 @@ void runGeneratorMode(const Args& a) {
 
 }
 
+void runConvertMode(const Args& a) {
+    LOG_INFO("Using Scoring Matrix: \"%s\"", a.matrixFilepath.c_str());
+    Matrix mat = MatrixIO::loadMatrixFromTSV(a.matrixFilepath);
+    uint64_t selfScoreKey = scoringKey(mat, a.doSine);
+
+    Dataset inputDataset(a.queryDatasetFilepath, a.resampleStep);
+    StringVector neuronIDVector = inputDataset.listNeuronIDs();
+
+    // a .nbp output is a single pack, anything else a directory of .nbn files
+    std::unique_ptr<NeuronPackWriter> packWriter;
+    if (hasExtension(a.targetDatasetFilepath, NEURON_PACK_EXT)) {
+        ensureDirectory(a.targetDatasetFilepath);
+        packWriter = std::make_unique<NeuronPackWriter>(a.targetDatasetFilepath);
+    } else {
+        std::filesystem::create_directories(a.targetDatasetFilepath);
+    }
+
+    // voxels one positive-scoring distance across, widened a little for
+    // rounding: no target it leaves out can score above zero, see DatasetIndex.
+    // A matrix scoring above zero at any distance cannot be indexed.
+    double reach = ScoreBound(mat).positiveReach();
+    std::unique_ptr<DatasetIndex> index;
+    if (std::isfinite(reach)) {
+        index = std::make_unique<DatasetIndex>((reach > 0 ? reach : mat.maxDistance()) * (1 + 1e-4), reach, 
+                                               mat.fingerprint());
+    } else {
+        std::cerr << "No spatial index written, " << a.matrixFilepath 
+                  << " scores matches above zero at any distance\n";
+    }
+
+    for (const auto& neuronID : neuronIDVector) {
+        Neuron n = inputDataset.load(neuronID);
+        n.selfScore = selfScore(mat, n, a.doSine);
+        n.selfScoreKey = selfScoreKey;
+        if (index) index->add(neuronID, n);
+
+        if (packWriter) {
+            LOG_DEBUG("packing \"%s\"", neuronID.c_str());
+            packWriter->append(neuronID, n);
+        } else {
+            std::string binaryFilepath = filenameToPath(a.targetDatasetFilepath, neuronID, NEURON_BINARY_EXT);
+            LOG_DEBUG("converting \"%s\" -> \"%s\"", neuronID.c_str(), binaryFilepath.c_str());
+            NeuronIO::writeBinary(binaryFilepath, n);
+        }
+    }
+    if (packWriter) {
+        packWriter->finish();
+    }
+    if (index) {
+        index->finish();
+        index->write(DatasetIndex::pathFor(a.targetDatasetFilepath));
+    }
+    LOG_INFO("converted %zu neurons", neuronIDVector.size());
+}
+
+void runAllByAllMode(const Args& a) {
+    LOG_INFO("Using Scoring Matrix: \"%s\"", a.matrixFilepath.c_str());
+    Matrix mat = MatrixIO::loadMatrixFromTSV(a.matrixFilepath);
+    mat.setCapFarMatches(a.capFarMatches);
+    reportFarMatchCap(a, mat);
+    Dataset dataset(a.queryDatasetFilepath, a.resampleStep);
+    StringVector neuronIDVector = a.positionalArgs.empty() ? dataset.listNeuronIDs() : a.positionalArgs;
+
+    // every neuron takes part in n pairs, so all of them are loaded up front
+    ThreadPool pool(a.numThreads ? a.numThreads : defaultThreadCount());
+    NeuronStore store(&mat, a.doSine);
+    store.preload(dataset, neuronIDVector, pool);
+
+    TimerStats ts;
+    size_t rescored = 0;
+    DoubleVector scores = timeFunction(ts, [&](){
+        if (a.coarseStep > 0) {
+            return allByAllCoarseToFine(mat, store, dataset, neuronIDVector, a.coarseStep, a.rescoreFraction, 
+                                        a.doSine, pool, rescored);
+        }
+        return allByAll(mat, store, dataset, neuronIDVector, a.doSine, pool);
+    });
+    std::cerr << "all-by-all: " << neuronIDVector.size() << " neurons scored in " << ts.getTotal() << "s, " 
+              << outOfReachPairCount() << " pairs out of reach\n";
+    if (a.coarseStep > 0) {
+        std::cerr << "all-by-all: " << rescored << " pairs rescored at full resolution\n";
+    }
+
+    std::ofstream fout;
+    if (!a.matrixOutfile.empty()) {
+        ensureDirectory(a.matrixOutfile);
+        fout.open(a.matrixOutfile);
+        if (!fout) { throw std::runtime_error("Cannot open " + a.matrixOutfile); }
+    }
+    std::ostream& out = a.matrixOutfile.empty() ? std::cout : fout;
+    // header row of neuron IDs, then one row of scores per neuron
+    const size_t n = neuronIDVector.size();
+    for (const auto& neuronID : neuronIDVector) {
+        out << "\t" << neuronID;
+    }
+    out << "\n";
+    for (size_t i = 0; i < n; ++i) {
+        out << neuronIDVector[i];
+        for (size_t j = 0; j < n; ++j) {
+            // pairs -z did not rescore
+            if (std::isnan(scores[i * n + j])) {
+                out << "\tNA";
+            } else {
+                out << "\t" << scores[i * n + j];
+            }
+        }
+        out << "\n";
+    }
+    out.flush();
+}
+
 int run(const Args& a) {
     switch (a.mode) {
         // query two neurons for given datasets, 
@@ -139,6 +450,17 @@ int run(const Args& a) {
             runGeneratorMode(a);
             break;
         }
+        // convert a dataset of swc files to binary neurons
+        case option_t::Convert: {
+            runConvertMode(a);
+            break;
+        }
+        // score every pair of one dataset, 
+        // print the symmetric score matrix to stdout unless specified
+        case option_t::AllByAll: {
+            runAllByAllMode(a);
+            break;
+        }
         default: { throw std::runtime_error("uncaught argument parsing error, invalid mode"); }
     }
     return 0;
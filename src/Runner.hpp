@@ -5,6 +5,8 @@
 
 void runQueryMode(const Args& a);
 void runGeneratorMode(const Args& a);
+void runConvertMode(const Args& a);
+void runAllByAllMode(const Args& a);
 int run(const Args& a);
 
 #endif // RUNNER_HPP
@@ -1,10 +1,12 @@
+#include "Scoring.hpp"
 #include "ArgParse.hpp"
 #include "Point.hpp"
 #include "StringUtils.hpp"
 #include "FileIO.hpp"
 #include "Error.hpp"
-#include "nanoflann.hpp"
 #include "Matrix.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -17,95 +19,96 @@
 #include <limits>
 #include <memory>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <tuple>
 
 // C-based includes
 #include <unistd.h>
 #include <cstring>
 #include <cassert>
 
-static PointVector buildMidpoints(const PointVector& pts) {
-    PointVector mp;
-    mp.reserve(pts.size());
+// nearest target segment of every query segment, by position in the
+// query; NeuronIndex::NONE where nothing lies within maxDistance. The
+// results live in per-thread scratch, valid until the next call.
+static void findNearestSegments(const Neuron& query, 
+                                const Neuron& target, 
+                                double maxDistance,
+                                const std::vector<size_t>*& nearestIdx,
+                                const std::vector<coord_t>*& distSqr) {
+    static thread_local std::vector<size_t> nearestScratch;
+    static thread_local std::vector<coord_t> distScratch;
+    nearestIdx = &nearestScratch;
+    distSqr = &distScratch;
 
-    for (const auto& pt : pts) {
-        if (pt.parent == -1) continue;
-        Point m = pt.midpoint(pts[pt.parent]);
-
-        // midpoint: id = original id, parent = -1
-        mp.emplace_back(pt.id, m.x, m.y, m.z, -1);
+    // reuse the target's tree when it was built at load time, by raw
+    // pointer so threads sharing a target do not contend on its refcount
+    const NeuronIndex* index = target.index.get();
+    std::unique_ptr<NeuronIndex> built;
+    if (!index) {
+        built = std::make_unique<NeuronIndex>(target.midpoints);
+        index = built.get();
     }
 
-    return mp;
+    // search every query midpoint at once, in the query's Morton order
+    std::vector<uint32_t> order;
+    if (!query.index) order = NeuronIndex::mortonOrder(query.midpoints);
+    index->nearestAll(query.midpoints, query.index ? query.index->curveOrder() : order, nearestScratch, distScratch, 
+                      static_cast<coord_t>(maxDistance * maxDistance));
 }
 
-PAVector nearestNeighborKDTree(const PointVector& query, 
-                               const PointVector& target, 
-                               bool doSine, 
-                               bool doPrint = false) {
-    // Build midpoints for query / target
-    PointVector queryMidpoints  = buildMidpoints(query);
-    PointVector targetMidpoints = buildMidpoints(target);
-
-    // Build point cloud for KD-tree
-    PointCloud cloud(targetMidpoints);
-
-    using KDTree = nanoflann::KDTreeSingleIndexAdaptor<
-        nanoflann::L2_Simple_Adaptor<double, PointCloud>,
-        PointCloud,
-        3
-    >;
-
-    KDTree index(3, cloud, nanoflann::KDTreeSingleIndexAdaptorParams(10));
-    index.buildIndex();
-
-    PAVector matchVector(query.size());
-    // For each query midpoint, perform nearest neighbor search
-    for (const auto& qmp : queryMidpoints) {
-        double query_pt[3] = { qmp.x, qmp.y, qmp.z };
+// fills matchVector with the nearest target segment of every query segment
+static void matchNearestSegments(const Neuron& query, 
+                                 const Neuron& target, 
+                                 bool doSine, 
+                                 bool doPrint, 
+                                 PAVector& matchVector) {
+    matchVector.clear();
+    if (target.size() == 0) return;
+    matchVector.reserve(query.size());
 
-        size_t nearestIdx = 0;
-        double outDistanceSqr = 0;
+    const std::vector<size_t>* nearestIdx;
+    const std::vector<coord_t>* distSqr;
+    findNearestSegments(query, target, std::numeric_limits<double>::infinity(), nearestIdx, distSqr);
 
-        nanoflann::KNNResultSet<double> resultSet(1);
-        resultSet.init(&nearestIdx, &outDistanceSqr);
-        index.findNeighbors(resultSet, query_pt, 0);
+    for (size_t i = 0; i < query.size(); ++i) {
+        const Point& qmp = query.midpoints[i];
+        size_t j = (*nearestIdx)[i];
 
-        const Point& tmp = targetMidpoints[nearestIdx];
-
-        // original query-side segment r_i
-        const Point& qi = query.at(qmp.id);
-        if (qi.parent == -1) continue;
-        const Point& qj = query.at(qi.parent);
-        Point r_i = qj - qi;
-
-        // original target-side segment s_i
-        const Point& ti = target.at(tmp.id);
-        if (ti.parent == -1) continue;
-        const Point& tj = target.at(ti.parent);
-        Point s_i = tj - ti;
-
-        // angle measure
-        double angleMeasure = r_i.angleMeasure(s_i, doSine);
+        // angle measure between the query segment r_i and target segment s_i
+        double angleMeasure = segmentAngleMeasure(query.tangents[i], target.tangents[j], doSine);
 
         // output: id_i id_j distance angle
-        PointAlignment pc{ qi.id, ti.id, std::sqrt(outDistanceSqr), angleMeasure };
-        matchVector[qi.id] = pc;
+        PointAlignment pc{ qmp.id, target.midpoints[j].id, std::sqrt((*distSqr)[i]), angleMeasure };
+        matchVector.push_back(pc);
         if (doPrint) {
             pc.printDifference(std::cout);
         }
     }
-    // remove first two elements (no midpoints at those ids)
-    if (matchVector.size() >= 2) {
-        matchVector.erase(matchVector.begin(), matchVector.begin() + 2);
-    }
+}
+
+PAVector nearestNeighborKDTree(const Neuron& query, 
+                               const Neuron& target, 
+                               bool doSine, 
+                               bool doPrint) {
+    PAVector matchVector;
+    matchNearestSegments(query, target, doSine, doPrint, matchVector);
     return matchVector;
 }
 
+PAVector nearestNeighborKDTree(const PointVector& query, 
+                               const PointVector& target, 
+                               bool doSine, 
+                               bool doPrint) {
+    return nearestNeighborKDTree(makeNeuron(query), makeNeuron(target), doSine, doPrint);
+}
+
 PAVector nearestNeighborNaive(const PointVector& query, 
                               const PointVector& target, 
                               bool doSine, 
                               bool doPrint) {
-    PAVector matchVector(query.size());
+    PAVector matchVector;
+    matchVector.reserve(query.size());
     for (const auto& query_i : query) {
         if (query_i.parent == POINT_DEFAULT_PARENT) continue;
         
@@ -135,7 +138,7 @@ PAVector nearestNeighborNaive(const PointVector& query,
             }
         }
         PointAlignment pm{ query_i.id, target_min.id, distance_min, angle_diff };
-        matchVector[pm.queryPointID] = pm;
+        matchVector.push_back(pm);
         if (doPrint) {
             pm.printDifference(std::cout);
         }
@@ -143,48 +146,186 @@ PAVector nearestNeighborNaive(const PointVector& query,
     return matchVector;
 }
 
-static void computeRawScores(const Matrix& mat, PAVector& matchVector) {
-    for (auto& pm : matchVector) {
-        if (pm.queryPointID == -1 || pm.targetPointID == -1) {
-            continue;
+// pairs scored in O(1) by outOfReach()
+static std::atomic<uint64_t> outOfReachPairs{0};
+
+bool outOfReach(const Matrix& mat, 
+                const Neuron& query, 
+                const Neuron& target) {
+    if (query.bounds.empty() || target.bounds.empty()) return false;
+    // a little past the last bin edge, so that rounding in the search's
+    // own distances can never put a match back inside it
+    double reach = mat.maxDistance() * (1 + 1e-4);
+    return query.bounds.distanceSqr(target.bounds) > reach * reach;
+}
+
+uint64_t outOfReachPairCount() {
+    return outOfReachPairs;
+}
+
+void pairRawScores(const Matrix& mat, 
+                   const Neuron& query, 
+                   const Neuron& target, 
+                   bool doSine,
+                   double& forwardRawScore,
+                   double& reverseRawScore) {
+    if (mat.capsFarMatches() && outOfReach(mat, query, target)) {
+        // every match either way lands beyond the last distance bin,
+        // where it scores farScore() whatever its angle
+        ++outOfReachPairs;
+        forwardRawScore = query.size() * mat.farScore();
+        reverseRawScore = target.size() * mat.farScore();
+        return;
+    }
+    forwardRawScore = directionalScore(mat, query, target, doSine);
+    reverseRawScore = directionalScore(mat, target, query, doSine);
+}
+
+ScoreBound::ScoreBound(const Matrix& mat) : rowBound(mat.rows()) {
+    for (double edge : mat.getDistanceBins()) edgesSqr.push_back(edge * edge);
+    double best = -std::numeric_limits<double>::infinity();
+    for (size_t i = mat.rows(); i-- > 0;) {
+        for (size_t j = 0; j < mat.cols(); ++j) best = std::max(best, mat.at(i, j));
+        rowBound[i] = best;
+    }
+}
+
+double ScoreBound::directional(const Neuron& query, const BoundingBox& box) const {
+    if (box.empty()) return 0;
+    double res = 0;
+    for (const auto& qmp : query.midpoints) {
+        // shrunk a little, so that rounding in the search's own distances
+        // can never put a match in an earlier row
+        double dSqr = box.distanceSqr(qmp) * (1 - 2e-4);
+        size_t row = std::lower_bound(edgesSqr.begin(), edgesSqr.end(), dSqr) - edgesSqr.begin();
+        res += rowBound[std::min(row, rowBound.size() - 1)];
+    }
+    return res;
+}
+
+double ScoreBound::positiveReach() const {
+    if (rowBound.back() > 0) return std::numeric_limits<double>::infinity();
+    // rows from the first non-positive bound on only hold matches beyond
+    // the upper edge of the row before it
+    size_t row = 0;
+    while (rowBound[row] > 0) ++row;
+    return row == 0 ? 0 : std::sqrt(edgesSqr[row - 1]);
+}
+
+double ScoreBound::pair(const Neuron& query, const Neuron& target) const {
+    if (!(query.selfScore > 0 && target.selfScore > 0)) return std::numeric_limits<double>::infinity();
+    return pairScore(directional(query, target.bounds), directional(target, query.bounds), query, target);
+}
+
+double directionalScore(const Matrix& mat, 
+                        const Neuron& query, 
+                        const Neuron& target, 
+                        bool doSine) {
+    if (target.size() == 0) return 0;
+    // stops at the last distance bin edge only where the matrix allows,
+    // matches beyond it otherwise need their angle looked up
+    const std::vector<size_t>* nearestIdx;
+    const std::vector<coord_t>* distSqr;
+    findNearestSegments(query, target, mat.searchLimit(), nearestIdx, distSqr);
+
+    // scored and summed as they are matched, in swc order, without
+    // building PointAlignments; nearestNeighborKDTree() has those
+    return mat.visit([&](const auto& scorer) {
+        double res = 0;
+        size_t far = 0;
+        for (size_t i = 0; i < query.size(); ++i) {
+            size_t j = (*nearestIdx)[i];
+            if (j == NeuronIndex::NONE) {
+                // beyond the last distance bin, the angle is never looked up
+                ++far;
+                continue;
+            }
+            double angleMeasure = segmentAngleMeasure(query.tangents[i], target.tangents[j], doSine);
+            if (angleMeasure < 0) {
+                std::cerr << "Invalid distance or angleMeasure\n";
+                exit(EXIT_FAILURE);
+            }
+            res += scorer.score(std::sqrt((*distSqr)[i]), angleMeasure);
         }
-        pm.computeRawScore(mat);
+        // added once, as pairRawScores() does for pairs out of reach
+        return res + far * mat.farScore();
+    });
+}
+
+// true if two segments share a midpoint, in which case the nearest
+// neighbour of a midpoint in its own neuron is not necessarily itself
+static bool hasDuplicateMidpoints(const PointVector& midpoints) {
+    using Key = std::tuple<double, double, double>;
+    std::vector<Key> keys;
+    keys.reserve(midpoints.size());
+    for (const auto& m : midpoints) {
+        keys.emplace_back(m.x, m.y, m.z);
     }
+    std::sort(keys.begin(), keys.end());
+    return std::adjacent_find(keys.begin(), keys.end()) != keys.end();
+}
+
+uint64_t scoringKey(const Matrix& mat, bool doSine) {
+    return mat.fingerprint() ^ static_cast<uint64_t>(doSine);
 }
 
-static double sumRawScores(PAVector vec) {
+double selfScore(const Matrix& mat, 
+                 const Neuron& neuron, 
+                 bool doSine) {
+    // Matching a neuron against itself pairs every midpoint with itself
+    // at distance 0, so only the angle of each segment with itself is
+    // needed. Summed in segment order, like the nearest neighbour pass.
+    if (hasDuplicateMidpoints(neuron.midpoints)) {
+        return directionalScore(mat, neuron, neuron, doSine);
+    }
     double res = 0;
-    for (const auto& elem : vec) {
-        res += elem.score;
+    for (const auto& t : neuron.tangents) {
+        double angleMeasure = segmentAngleMeasure(t, t, doSine);
+        if (angleMeasure < 0) {
+            // zero-length segment, let the full pass report it
+            return directionalScore(mat, neuron, neuron, doSine);
+        }
+        res += mat.score(0, angleMeasure);
     }
     return res;
 }
 
+// computes the neuron's self-score unless it already holds one for this matrix
+void ensureSelfScore(Neuron& neuron, 
+                     const Matrix& mat, 
+                     bool doSine) {
+    uint64_t key = scoringKey(mat, doSine);
+    if (neuron.selfScoreKey != key) {
+        neuron.selfScore = selfScore(mat, neuron, doSine);
+        neuron.selfScoreKey = key;
+    }
+}
+
 double scoreNeuronPair(const Matrix& mat, 
                        const PointVector& queryVector, 
                        const PointVector& targetVector, 
                        bool doSine) {
-    // compute forward score
-    PAVector forwardMatchVector = nearestNeighborKDTree(queryVector, targetVector, doSine);
-    computeRawScores(mat, forwardMatchVector);
-    double forwardTotalScore = sumRawScores(forwardMatchVector);
-
-    // compute forward self score
-    PAVector forwardSelfMatchVector = nearestNeighborKDTree(queryVector, queryVector, doSine);
-    computeRawScores(mat, forwardSelfMatchVector);
-    double forwardSelfTotalScore = sumRawScores(forwardSelfMatchVector);
-
-    // compute reverse score
-    PAVector reverseMatchVector = nearestNeighborKDTree(targetVector, queryVector, doSine);
-    computeRawScores(mat, reverseMatchVector);
-    double reverseTotalScore = sumRawScores(reverseMatchVector);
-
-    // compute reverse self score
-    PAVector reverseSelfMatchVector = nearestNeighborKDTree(targetVector, targetVector, doSine);
-    computeRawScores(mat, reverseSelfMatchVector);
-    double reverseSelfTotalScore = sumRawScores(reverseSelfMatchVector);
-    
+    Neuron query = makeNeuron(queryVector);
+    Neuron target = makeNeuron(targetVector);
+    query.selfScore = selfScore(mat, query, doSine);
+    target.selfScore = selfScore(mat, target, doSine);
+    return scoreNeuronPair(mat, query, target, doSine);
+}
+
+double scoreNeuronPair(const Matrix& mat, 
+                       const Neuron& query, 
+                       const Neuron& target, 
+                       bool doSine) {
+    double forwardTotalScore, reverseTotalScore;
+    pairRawScores(mat, query, target, doSine, forwardTotalScore, reverseTotalScore);
+    return pairScore(forwardTotalScore, reverseTotalScore, query, target);
+}
+
+double pairScore(double forwardRawScore, 
+                 double reverseRawScore, 
+                 const Neuron& query, 
+                 const Neuron& target) {
     // normalize forward and reverse by self
     // then average for final score
-    return ((forwardTotalScore / forwardSelfTotalScore) + (reverseTotalScore / reverseSelfTotalScore)) / 2;
+    return ((forwardRawScore / query.selfScore) + (reverseRawScore / target.selfScore)) / 2;
 }
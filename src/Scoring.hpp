@@ -3,7 +3,14 @@
 
 #include "Matrix.hpp"
 #include "Point.hpp"
+#include "Neuron.hpp"
 
+#include <cstdint>
+
+PAVector nearestNeighborKDTree(const Neuron& query, 
+                               const Neuron& target, 
+                               bool doSine = false, 
+                               bool doPrint = false);
 PAVector nearestNeighborKDTree(const PointVector& query, 
                                const PointVector& target, 
                                bool doSine = false, 
@@ -12,9 +19,64 @@ PAVector nearestNeighborNaive(const PointVector& query,
                               const PointVector& target, 
                               bool doSine = false, 
                               bool doPrint = false);
+// summed raw score of matching each query segment to its nearest target segment
+double directionalScore(const Matrix& mat, 
+                        const Neuron& query, 
+                        const Neuron& target, 
+                        bool doSine = false);
+// true if the bounding boxes of two neurons are further apart than the
+// last distance bin edge, so every match between them scores farScore()
+bool outOfReach(const Matrix& mat, 
+                const Neuron& query, 
+                const Neuron& target);
+// forward and reverse raw scores of a pair, in O(1) when it is outOfReach()
+// and the matrix capsFarMatches()
+void pairRawScores(const Matrix& mat, 
+                   const Neuron& query, 
+                   const Neuron& target, 
+                   bool doSine,
+                   double& forwardRawScore,
+                   double& reverseRawScore);
+// pairs pairRawScores() has found out of reach since startup
+uint64_t outOfReachPairCount();
+// Upper bounds on scores from bounding boxes alone. A segment is at least
+// as far from its match as from the box around the other neuron, so it
+// scores at most the best entry of that distance row or any row after it.
+class ScoreBound {
+    public:
+        explicit ScoreBound(const Matrix& mat);
+        // bound on directionalScore() of query against any neuron inside box
+        double directional(const Neuron& query, const BoundingBox& box) const;
+        // bound on pairScore() of the two, infinite without positive self-scores
+        double pair(const Neuron& query, const Neuron& target) const;
+        // distance beyond which no match scores above zero, infinite if
+        // the last row has a positive entry
+        double positiveReach() const;
+    private:
+        // squared distance bin edges
+        DoubleVector edgesSqr;
+        // best entry of each row and every row after it
+        DoubleVector rowBound;
+};
+// final pair score from the forward (query to target) and reverse raw scores
+double pairScore(double forwardRawScore, 
+                 double reverseRawScore, 
+                 const Neuron& query, 
+                 const Neuron& target);
+uint64_t scoringKey(const Matrix& mat, bool doSine);
+double selfScore(const Matrix& mat, 
+                 const Neuron& neuron, 
+                 bool doSine = false);
+void ensureSelfScore(Neuron& neuron, 
+                     const Matrix& mat, 
+                     bool doSine = false);
 double scoreNeuronPair(const Matrix& mat, 
                        const PointVector& queryVector, 
                        const PointVector& targetVector, 
                        bool doSine = false);
+double scoreNeuronPair(const Matrix& mat, 
+                       const Neuron& query, 
+                       const Neuron& target, 
+                       bool doSine = false);
 
 #endif // SCORING_HPP
\ No newline at end of file
@@ -45,6 +45,20 @@ int stringToUInt(const std::string& str, uint64_t& res) {
         return -2;
     }
 }
+int stringToDouble(const std::string& str, double& res) {
+    try {
+        size_t end = 0;
+        res = std::stod(str, &end);
+        return end == str.size() ? 0 : -1;
+    } catch (const std::invalid_argument& e) {
+        return -1;
+    } catch (const std::out_of_range& e) {
+        return -2;
+    }
+}
+bool hasExtension(const std::string& str, const std::string& ext) {
+    return str.size() >= ext.size() && str.compare(str.size() - ext.size(), ext.size(), ext) == 0;
+}
 
 std::string filenameToPath(const std::string& directoryPath, const std::string& filename, const std::string& ext) {
     if (directoryPath.at(directoryPath.size() - 1) == '/') {
@@ -7,6 +7,8 @@ int basename(const std::string& str, std::string& res);
 int basenameNoExt(const std::string& str, std::string& res);
 int splitOnComma(const std::string& str, std::pair<std::string, std::string>& res);
 int stringToUInt(const std::string& str, uint64_t& res);
+int stringToDouble(const std::string& str, double& res);
+bool hasExtension(const std::string& str, const std::string& ext);
 std::string filenameToPath(const std::string& directoryPath, const std::string& filename, const std::string& ext = "");
 
 #endif // STRING_UTILS_HPP
\ No newline at end of file
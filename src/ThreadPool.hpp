@@ -0,0 +1,96 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// number of worker threads to use when none is requested
+inline size_t defaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Fixed set of worker threads pulling tasks from a shared FIFO queue.
+class ThreadPool {
+    public:
+        explicit ThreadPool(size_t numThreads = defaultThreadCount()) {
+            numThreads = std::max<size_t>(numThreads, 1);
+            workers.reserve(numThreads);
+            for (size_t i = 0; i < numThreads; ++i) {
+                workers.emplace_back([this]() { work(); });
+            }
+        }
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            ready.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template<typename F>
+        auto submit(F&& func) {
+            using ReturnType = std::invoke_result_t<F>;
+            auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(func));
+            std::future<ReturnType> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([task]() { (*task)(); });
+            }
+            ready.notify_one();
+            return result;
+        }
+
+        inline size_t size() const { return workers.size(); }
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable ready;
+        bool stopping = false;
+
+        void work() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        }
+};
+
+// Runs func(i) for every i in [0, n) on the pool, in contiguous chunks,
+// and rethrows the first exception once every chunk has finished.
+template<typename F>
+void parallelFor(ThreadPool& pool, size_t n, F&& func) {
+    size_t numChunks = std::min(n, pool.size() * 4);
+    std::vector<std::future<void>> chunks;
+    chunks.reserve(numChunks);
+    for (size_t c = 0; c < numChunks; ++c) {
+        size_t begin = n * c / numChunks;
+        size_t end = n * (c + 1) / numChunks;
+        chunks.push_back(pool.submit([&func, begin, end]() {
+            for (size_t i = begin; i < end; ++i) func(i);
+        }));
+    }
+    for (auto& chunk : chunks) chunk.wait();
+    for (auto& chunk : chunks) chunk.get();
+}
+
+#endif // THREAD_POOL_HPP
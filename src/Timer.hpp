@@ -16,6 +16,7 @@ public:
     }
 
     size_t getCount() const { return count; }
+    double getTotal() const { return total; }
     double mean() const {
         return count ? total / count : 0.0;
     }
@@ -0,0 +1,31 @@
+#ifndef PRELOADED_DATASET_HPP
+#define PRELOADED_DATASET_HPP
+
+#include "Dataset.hpp"
+#include "Matrix.hpp"
+#include "MatrixIO.hpp"
+#include "NeuronStore.hpp"
+#include "ThreadPool.hpp"
+
+#include <string>
+
+static const std::string TRACES_DIR = "regression-tests/input/fctraces20-swc";
+
+// a dataset and the smat.fcwb matrix, every neuron preloaded into store
+struct PreloadedDataset {
+    Matrix mat;
+    Dataset dataset;
+    StringVector ids;
+    ThreadPool pool;
+    NeuronStore store;
+
+    explicit PreloadedDataset(const std::string& path) 
+        : mat(MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv")), 
+        dataset(path), ids(dataset.listNeuronIDs()), pool(2), store(&mat) {
+        store.preload(dataset, ids, pool);
+    }
+
+    inline const Neuron& get(const std::string& neuronID) { return *store.get(dataset, neuronID); }
+};
+
+#endif // PRELOADED_DATASET_HPP
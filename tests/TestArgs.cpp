@@ -1,6 +1,8 @@
 #include "Test.hpp"
 #include "ArgParse.hpp"
 
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <unistd.h>
 #include <sys/wait.h>
@@ -90,3 +92,141 @@ TEST_CASE(test_args_parse_sine_flag) {
 
     REQUIRE(args.doSine);
 }
+
+TEST_CASE(test_args_parse_cache_capacity) {
+    optind = 1;
+    Args args;
+
+    auto argv = make_argv({
+        "prog",
+        "-q",
+        "matrix.tsv",
+        "-c",
+        "256",
+        "-i",
+        "/tmp/test1,/tmp/test2"
+    });
+
+    int argc = argv.size() - 1;
+
+    args = parseArgs(argc, argv.data());
+
+    REQUIRE_EQ(args.cacheCapacityMiB, 256u);
+
+    // a byte count that would overflow size_t
+    optind = 1;
+    std::string tooLarge = std::to_string((SIZE_MAX >> 20) + 1);
+    auto overflow = make_argv({
+        "prog",
+        "-q",
+        "matrix.tsv",
+        "-c",
+        tooLarge.c_str(),
+        "-i",
+        "/tmp/test1,/tmp/test2"
+    });
+    bool threw = false;
+    try {
+        parseArgs(overflow.size() - 1, overflow.data());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_args_parse_top_k) {
+    optind = 1;
+    Args args;
+
+    auto argv = make_argv({
+        "prog",
+        "-q",
+        "matrix.tsv",
+        "-k",
+        "10",
+        "-i",
+        "/tmp/test1,/tmp/test2",
+        "query-0"
+    });
+
+    int argc = argv.size() - 1;
+
+    args = parseArgs(argc, argv.data());
+
+    REQUIRE_EQ(args.topK, 10u);
+    REQUIRE_EQ(args.positionalArgs.size(), 1u);
+
+    // no query to search for
+    optind = 1;
+    auto noQuery = make_argv({
+        "prog",
+        "-q",
+        "matrix.tsv",
+        "-k",
+        "10",
+        "-i",
+        "/tmp/test1,/tmp/test2"
+    });
+    bool threw = false;
+    try {
+        parseArgs(noQuery.size() - 1, noQuery.data());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_args_parse_coarse_to_fine) {
+    optind = 1;
+    auto argv = make_argv({
+        "prog",
+        "-a",
+        "matrix.tsv",
+        "-z",
+        "7.5,0.1",
+        "-i",
+        "/tmp/test1,/tmp/test1"
+    });
+
+    Args args = parseArgs(argv.size() - 1, argv.data());
+
+    REQUIRE_EQ(args.coarseStep, 7.5);
+    REQUIRE_EQ(args.rescoreFraction, 0.1);
+
+    // a fraction above 1 is rejected
+    optind = 1;
+    auto badFraction = make_argv({
+        "prog",
+        "-a",
+        "matrix.tsv",
+        "-z",
+        "7.5,2",
+        "-i",
+        "/tmp/test1,/tmp/test1"
+    });
+    bool threw = false;
+    try {
+        parseArgs(badFraction.size() - 1, badFraction.data());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_args_parse_resample) {
+    optind = 1;
+    auto argv = make_argv({
+        "prog",
+        "-q",
+        "matrix.tsv",
+        "--resample",
+        "1.5",
+        "-i",
+        "/tmp/test1,/tmp/test2"
+    });
+
+    Args args = parseArgs(argv.size() - 1, argv.data());
+
+    REQUIRE_EQ(args.resampleStep, 1.5);
+    REQUIRE_EQ(args.mode, option_t::Query);
+}
@@ -0,0 +1,61 @@
+#include "Test.hpp"
+#include "BruteForceNN.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
+
+#include <limits>
+#include <vector>
+
+// x, y and z arrays of pts, NaN padded
+static std::vector<std::vector<coord_t>> toAxes(const PointVector& pts) {
+    size_t padded = (pts.size() + BRUTE_FORCE_PADDING - 1) / BRUTE_FORCE_PADDING * BRUTE_FORCE_PADDING;
+    std::vector<std::vector<coord_t>> axes(3, std::vector<coord_t>(padded, std::numeric_limits<coord_t>::quiet_NaN()));
+    for (size_t i = 0; i < pts.size(); ++i) {
+        axes[0][i] = pts[i].x;
+        axes[1][i] = pts[i].y;
+        axes[2][i] = pts[i].z;
+    }
+    return axes;
+}
+
+TEST_CASE(test_BruteForceNN_matches_kdtree) {
+    Neuron target = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    Neuron query = loadNeuron("tests/test_data/swc/fafb/fafb-1.swc");
+    NeuronIndex index(target.midpoints);
+    auto axes = toAxes(target.midpoints);
+
+    for (const auto* kernel : supportedBruteForceKernels()) {
+        size_t unique = 0;
+        for (const auto& qmp : query.midpoints) {
+            coord_t pt[3] = { qmp.x, qmp.y, qmp.z };
+            size_t scanIdx;
+            coord_t scanDist, treeDist;
+            if (!kernel->nearest(axes[0].data(), axes[1].data(), axes[2].data(), axes[0].size(), 
+                                 pt, scanIdx, scanDist)) continue;
+            ++unique;
+            REQUIRE_EQ(scanIdx, index.nearestInTree(pt, treeDist));
+            REQUIRE_EQ(scanDist, treeDist);
+        }
+        REQUIRE(unique > query.size() / 2);
+    }
+}
+
+TEST_CASE(test_BruteForceNN_reports_ties) {
+    PointVector pts = {
+        Point(1, 0, 0, 0, -1),
+        Point(2, 2, 0, 0, -1),
+        Point(3, 5, 5, 5, -1)
+    };
+    auto axes = toAxes(pts);
+    coord_t between[3] = { 1, 0, 0 };
+    coord_t nearFirst[3] = { 0.5, 0, 0 };
+
+    for (const auto* kernel : supportedBruteForceKernels()) {
+        size_t idx;
+        coord_t distSqr;
+        REQUIRE(!kernel->nearest(axes[0].data(), axes[1].data(), axes[2].data(), axes[0].size(), between, idx, distSqr));
+        REQUIRE(kernel->nearest(axes[0].data(), axes[1].data(), axes[2].data(), axes[0].size(), nearFirst, idx, distSqr));
+        REQUIRE_EQ(idx, static_cast<size_t>(0));
+        REQUIRE_EQ(distSqr, 0.25);
+    }
+}
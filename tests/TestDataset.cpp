@@ -0,0 +1,79 @@
+#include "Test.hpp"
+#include "Dataset.hpp"
+#include "NeuronPack.hpp"
+#include "NeuronIO.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+static const std::string FAFB_DIR = "tests/test_data/swc/fafb";
+
+TEST_CASE(test_Dataset_directory_lists_ids) {
+    Dataset fafb(FAFB_DIR);
+
+    StringVector ids = fafb.listNeuronIDs();
+
+    REQUIRE(!fafb.isPack());
+    REQUIRE_EQ(ids.size(), static_cast<size_t>(2));
+    REQUIRE_EQ(ids[0], "fafb-0");
+    REQUIRE_EQ(ids[1], "fafb-1");
+}
+
+TEST_CASE(test_Dataset_pack_matches_directory) {
+    char filename[] = "/tmp/test-pack-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1) { perror("mkstemp"); throw std::runtime_error("Failed to create temp file"); }
+    close(fd);
+
+    Dataset fafb(FAFB_DIR);
+    NeuronPackWriter writer(filename);
+    for (const auto& id : fafb.listNeuronIDs()) {
+        writer.append(id, fafb.load(id));
+    }
+    writer.finish();
+
+    Dataset packed(filename);
+    REQUIRE(packed.isPack());
+    REQUIRE_EQ(packed.listNeuronIDs().size(), static_cast<size_t>(2));
+
+    Neuron expected = fafb.load("fafb-1");
+    Neuron actual = packed.load("fafb-1");
+    std::remove(filename);
+
+    REQUIRE_EQ(actual.size(), expected.size());
+    REQUIRE_EQ(actual.midpoints.back().x, expected.midpoints.back().x);
+    REQUIRE_EQ(actual.tangents.front().z, expected.tangents.front().z);
+}
+
+TEST_CASE(test_Dataset_prefers_newer_swc_over_binary) {
+    namespace fs = std::filesystem;
+    char dirname[] = "/tmp/test-dataset-XXXXXX";
+    if (!mkdtemp(dirname)) { perror("mkdtemp"); throw std::runtime_error("Failed to create temp dir"); }
+    const std::string dir = dirname;
+
+    // x.nbn holds fafb-0, x.swc holds fafb-1
+    Dataset fafb(FAFB_DIR);
+    Neuron binaryNeuron = fafb.load("fafb-0");
+    Neuron swcNeuron = fafb.load("fafb-1");
+    NeuronIO::writeBinary(dir + "/x.nbn", binaryNeuron);
+    fs::copy_file(FAFB_DIR + "/fafb-1.swc", dir + "/x.swc");
+
+    auto now = fs::file_time_type::clock::now();
+    fs::last_write_time(dir + "/x.swc", now - std::chrono::hours(1));
+    fs::last_write_time(dir + "/x.nbn", now);
+    size_t freshBinarySize = Dataset(dir).load("x").size();
+
+    fs::last_write_time(dir + "/x.swc", now + std::chrono::hours(1));
+    Dataset stale(dir);
+    size_t staleBinarySize = stale.load("x").size();
+    StringVector ids = stale.listNeuronIDs();
+    fs::remove_all(dir);
+
+    REQUIRE(binaryNeuron.size() != swcNeuron.size());
+    REQUIRE_EQ(freshBinarySize, binaryNeuron.size());
+    REQUIRE_EQ(staleBinarySize, swcNeuron.size());
+    REQUIRE_EQ(ids.size(), static_cast<size_t>(1));
+    REQUIRE_EQ(ids[0], "x");
+}
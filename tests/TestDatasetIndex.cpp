@@ -0,0 +1,96 @@
+#include "Test.hpp"
+#include "Dataset.hpp"
+#include "DatasetIndex.hpp"
+#include "Neuron.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// true if some midpoints of a and b are within distance of each other
+static bool within(const Neuron& a, const Neuron& b, double distance) {
+    for (const auto& p : a.midpoints) {
+        for (const auto& q : b.midpoints) {
+            double dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+            if (dx * dx + dy * dy + dz * dz <= distance * distance) return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE(test_DatasetIndex_finds_every_neuron_within_a_voxel) {
+    Dataset traces("regression-tests/input/fctraces20-swc");
+    StringVector ids = traces.listNeuronIDs();
+    std::vector<Neuron> neurons;
+    DatasetIndex index(12);
+    for (const auto& id : ids) {
+        neurons.push_back(traces.load(id));
+        index.add(id, neurons.back());
+    }
+    index.finish();
+    REQUIRE_EQ(index.size(), ids.size());
+
+    size_t skipped = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        StringVector candidates = index.overlapping(neurons[i]);
+        REQUIRE(std::is_sorted(candidates.begin(), candidates.end()));
+        for (size_t j = 0; j < ids.size(); ++j) {
+            bool found = std::binary_search(candidates.begin(), candidates.end(), ids[j]);
+            if (within(neurons[i], neurons[j], index.getVoxelSize())) REQUIRE(found);
+            if (found) REQUIRE(within(neurons[i], neurons[j], 2 * std::sqrt(3.0) * index.getVoxelSize()));
+            skipped += !found;
+        }
+    }
+    // some pairs of fctraces20 are far apart
+    REQUIRE(skipped > 0);
+}
+
+TEST_CASE(test_DatasetIndex_roundtrip) {
+    char filename[] = "/tmp/test-dataset-index-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1) { perror("mkstemp"); throw std::runtime_error("Failed to create temp file"); }
+    close(fd);
+
+    Dataset fafb("tests/test_data/swc/fafb");
+    Dataset banc("tests/test_data/swc/banc");
+    DatasetIndex index(5000, 4000, 0x1234abcd);
+    for (const auto& id : fafb.listNeuronIDs()) index.add(id, fafb.load(id));
+    index.finish();
+    index.write(filename);
+    DatasetIndex read = DatasetIndex::read(filename);
+    std::remove(filename);
+
+    REQUIRE_EQ(read.getVoxelSize(), 5000.0);
+    REQUIRE_EQ(read.getReach(), 4000.0);
+    REQUIRE_EQ(read.getMatrixFingerprint(), static_cast<uint64_t>(0x1234abcd));
+    REQUIRE_EQ(read.size(), index.size());
+    for (const auto& id : fafb.listNeuronIDs()) {
+        Neuron query = fafb.load(id);
+        REQUIRE(read.overlapping(query) == index.overlapping(query));
+        REQUIRE(!index.overlapping(query).empty());
+    }
+    // banc is in another space altogether
+    for (const auto& id : banc.listNeuronIDs()) {
+        REQUIRE(read.overlapping(banc.load(id)).empty());
+    }
+}
+
+TEST_CASE(test_DatasetIndex_reach_fits_in_a_voxel) {
+    bool threw = false;
+    try {
+        DatasetIndex index(10, 12);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_DatasetIndex_paths) {
+    REQUIRE_EQ(DatasetIndex::pathFor("data/fafb.nbp"), "data/fafb.nbx");
+    REQUIRE_EQ(DatasetIndex::pathFor("data/fafb"), "data/fafb/dataset.nbx");
+}
@@ -0,0 +1,104 @@
+#include "Test.hpp"
+#include "FileIO.hpp"
+#include "Point.hpp"
+
+#include <filesystem>
+#include <string>
+
+#include <zlib.h>
+
+TEST_CASE(test_FileIO_parsePoints_fields) {
+    std::string swc = 
+        "# PointNo Label X Y Z Radius Parent\n"
+        "1 2 314.969562 83.7372323 22.4337484 NA -1\n"
+        "\n"
+        "2\t2\t-1.5\t+2e3\t0\t1.25\t1\r\n"
+        "3 2 4 5 6 NA 2";
+
+    PointVector pts = parsePoints(swc.data(), swc.size(), "inline");
+
+    REQUIRE_EQ(pts.size(), static_cast<size_t>(3));
+    REQUIRE_EQ(pts[0].id, 1);
+    REQUIRE_EQ(pts[0].x, static_cast<coord_t>(314.969562));
+    REQUIRE_EQ(pts[0].parent, -1);
+    REQUIRE_EQ(pts[1].x, -1.5);
+    REQUIRE_EQ(pts[1].y, 2000.0);
+    REQUIRE_EQ(pts[1].parent, 0);
+    REQUIRE_EQ(pts[2].z, 6.0);
+    REQUIRE_EQ(pts[2].parent, 1);
+}
+
+TEST_CASE(test_FileIO_parsePoints_malformed) {
+    std::string swc = "1 2 0 0 0 NA -1\n2 2 0 x 0 NA 1\n";
+    bool threw = false;
+    try {
+        parsePoints(swc.data(), swc.size(), "inline");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_FileIO_parsePoints_sparse_unordered_ids) {
+    // children listed before their parents, ids far from 0..n-1
+    std::string swc = 
+        "9000 2 3 0 0 NA 500\n"
+        "500 2 2 0 0 NA 70\n"
+        "70 2 1 0 0 NA -1\n"
+        "8 2 9 9 9 NA 70\n";
+
+    PointVector pts = parsePoints(swc.data(), swc.size(), "inline");
+
+    REQUIRE_EQ(pts.size(), static_cast<size_t>(4));
+    for (size_t i = 0; i < pts.size(); ++i) {
+        REQUIRE(pts[i].parent < static_cast<int>(i));
+    }
+    REQUIRE_EQ(pts[0].id, 70);
+    REQUIRE_EQ(pts[0].parent, -1);
+    REQUIRE_EQ(pts[1].id, 500);
+    REQUIRE_EQ(pts[2].id, 9000);
+    REQUIRE_EQ(pts[2].parent, 1);
+    REQUIRE_EQ(pts[3].id, 8);
+    REQUIRE_EQ(pts[3].parent, 0);
+}
+
+TEST_CASE(test_FileIO_parsePoints_unknown_parent) {
+    std::string swc = "1 2 0 0 0 NA -1\n2 2 1 0 0 NA 7\n";
+    bool threw = false;
+    try {
+        parsePoints(swc.data(), swc.size(), "inline");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_FileIO_loadPoints_file) {
+    PointVector pts = loadPoints("tests/test_data/swc/banc/banc-0.swc");
+
+    REQUIRE_EQ(pts[0].x, 886720.0);
+    REQUIRE_EQ(pts[1].parent, 0);
+}
+
+TEST_CASE(test_FileIO_loadPoints_gzip) {
+    // large enough that lines straddle decode chunks
+    std::string swc = "# gzip\n1 1 0 0 0 NA -1\n";
+    for (int i = 2; i <= 5000; ++i) {
+        swc += std::to_string(i) + " 2 " + std::to_string(i * 0.5) + " 1.25 -3 NA " + std::to_string(i - 1) + "\n";
+    }
+    std::string filepath = "/tmp/nblast_test_gzip.swc.gz";
+    gzFile file = gzopen(filepath.c_str(), "wb");
+    gzwrite(file, swc.data(), swc.size());
+    gzclose(file);
+
+    PointVector expected = parsePoints(swc.data(), swc.size(), "inline");
+    PointVector pts = loadPoints(filepath);
+    std::filesystem::remove(filepath);
+
+    REQUIRE_EQ(pts.size(), expected.size());
+    for (size_t i = 0; i < pts.size(); ++i) {
+        REQUIRE_EQ(pts[i].id, expected[i].id);
+        REQUIRE_EQ(pts[i].x, expected[i].x);
+        REQUIRE_EQ(pts[i].parent, expected[i].parent);
+    }
+}
@@ -4,7 +4,9 @@
 #include <sstream>
 #include <fstream>
 
+#include <cmath>
 #include <cstdio>
+#include <stdexcept>
 #include <unistd.h>
 
 TEST_CASE(test_Matrix_loadMatrixFromTSV) {
@@ -26,16 +28,13 @@ TEST_CASE(test_Matrix_loadMatrixFromTSV) {
     REQUIRE_EQ(m.getAngleBins().size(), static_cast<size_t>(3));
 
     // check table contents
-    REQUIRE_EQ(m.getTable()[0][0], 1);
-    REQUIRE_EQ(m.getTable()[0][1], 2);
-    REQUIRE_EQ(m.getTable()[1][2], 6);
+    REQUIRE_EQ(m.at(0, 0), 1);
+    REQUIRE_EQ(m.at(0, 1), 2);
+    REQUIRE_EQ(m.at(1, 2), 6);
 }
 
 TEST_CASE(test_Matrix_increment_and_score) {
-    Matrix m;
-    m.getDistanceBins() = {1, 2};
-    m.getAngleBins() = {0.1, 0.2};
-    m.getTable() = {{0, 0}, {0, 0}};
+    Matrix m({1, 2}, {0.1, 0.2}, {0, 0, 0, 0});
 
     m.increment(0.5, 0.05);
     REQUIRE_EQ(m.score(0.5, 0.05), 1);
@@ -45,10 +44,7 @@ TEST_CASE(test_Matrix_increment_and_score) {
 }
 
 TEST_CASE(test_Matrix_prefixSum) {
-    Matrix m;
-    m.getDistanceBins() = {1, 2};
-    m.getAngleBins() = {0.1, 0.2};
-    m.getTable() = {{1, 2}, {3, 4}};
+    Matrix m({1, 2}, {0.1, 0.2}, {1, 2, 3, 4});
 
     m.prefixSum();
 
@@ -57,17 +53,14 @@ TEST_CASE(test_Matrix_prefixSum) {
     // table[0][1] = 2
     // table[1][0] = 3 + 1 = 4
     // table[1][1] = 4 + 2 + 2? check logic: yes cumulative row + above row
-    REQUIRE_EQ(m.getTable()[0][0], 1);
-    REQUIRE_EQ(m.getTable()[0][1], 3);
-    REQUIRE_EQ(m.getTable()[1][0], 4);
-    REQUIRE_EQ(m.getTable()[1][1], 10);
+    REQUIRE_EQ(m.at(0, 0), 1);
+    REQUIRE_EQ(m.at(0, 1), 3);
+    REQUIRE_EQ(m.at(1, 0), 4);
+    REQUIRE_EQ(m.at(1, 1), 10);
 }
 
 TEST_CASE(test_Matrix_output_operator) {
-    Matrix m;
-    m.getDistanceBins() = {1};
-    m.getAngleBins() = {0.1};
-    m.getTable() = {{42}};
+    Matrix m({1}, {0.1}, {42});
 
     std::stringstream ss;
     ss << m;
@@ -75,3 +68,64 @@ TEST_CASE(test_Matrix_output_operator) {
     REQUIRE(ss.str().find("42") != std::string::npos);
 }
 
+
+// first bin whose upper edge holds value, else the last one
+static size_t scanBin(const DoubleVector& edges, double value) {
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (value <= edges[i]) return i;
+    }
+    return edges.size() - 1;
+}
+
+TEST_CASE(test_Matrix_lookup_matches_linear_scan) {
+    Matrix fcwb = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    DoubleVector uneven = { 0.05, 0.3, 0.31, 0.7, 1 };
+    DoubleVector table(fcwb.rows() * uneven.size());
+    for (size_t i = 0; i < table.size(); ++i) table[i] = i;
+    Matrix custom(fcwb.getDistanceBins(), uneven, table);
+    DoubleVector bancTable(NUM_DISTANCE_BINS * NUM_ANGLE_BINS);
+    for (size_t i = 0; i < bancTable.size(); ++i) bancTable[i] = i;
+    Matrix banc(DoubleVector(DISTANCE_BINS.begin(), DISTANCE_BINS.end()), 
+                DoubleVector(ANGLE_BINS.begin(), ANGLE_BINS.end()), bancTable);
+    REQUIRE(fcwb.isFixed());
+    REQUIRE(banc.isFixed());
+    REQUIRE(!custom.isFixed());
+
+    for (const Matrix* m : { &fcwb, &custom, &banc }) {
+        const DoubleVector& distances = m->getDistanceBins();
+        const DoubleVector& angles = m->getAngleBins();
+        // every edge, its neighbours either side and points in between
+        DoubleVector distanceProbes = { 0, 1e9 }, angleProbes = { 0, 1 };
+        for (double d : distances) {
+            distanceProbes.insert(distanceProbes.end(), { d, std::nextafter(d, -1.0), std::nextafter(d, 1e9), d * 0.999 });
+        }
+        for (double a : angles) {
+            angleProbes.insert(angleProbes.end(), { a, std::nextafter(a, -1.0), std::nextafter(a, 2.0), a * 0.999 });
+        }
+        for (int k = 0; k <= 1000; ++k) angleProbes.push_back(k / 1000.0);
+
+        for (double d : distanceProbes) {
+            for (double a : angleProbes) {
+                double expected = m->at(scanBin(distances, d), scanBin(angles, a));
+                REQUIRE_EQ(m->score(d, a), expected);
+                REQUIRE_EQ(m->visit([&](const auto& scorer) { return scorer.score(d, a); }), expected);
+            }
+        }
+    }
+}
+
+TEST_CASE(test_Matrix_rejects_mismatched_table) {
+    int thrown = 0;
+    try { Matrix m({1, 2}, {0.5, 1}, {1, 2, 3}); } catch (const std::runtime_error&) { ++thrown; }
+    try { Matrix m({2, 1}, {0.5, 1}, {1, 2, 3, 4}); } catch (const std::runtime_error&) { ++thrown; }
+    REQUIRE_EQ(thrown, 2);
+}
+
+TEST_CASE(test_Matrix_writes_drop_fixed_copy) {
+    Matrix m(DoubleVector(DISTANCE_BINS.begin(), DISTANCE_BINS.end()), 
+             DoubleVector(ANGLE_BINS.begin(), ANGLE_BINS.end()));
+    REQUIRE(m.isFixed());
+    m.at(0, 0) = 5;
+    REQUIRE(!m.isFixed());
+    REQUIRE_EQ(m.visit([](const auto& scorer) { return scorer.score(0, 0); }), 5.0);
+}
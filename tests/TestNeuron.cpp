@@ -0,0 +1,104 @@
+#include "Test.hpp"
+#include "Neuron.hpp"
+#include "FileIO.hpp"
+#include "Dataset.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+TEST_CASE(test_Neuron_resampled_skeleton_has_even_steps) {
+    PointVector points = loadPoints("tests/test_data/swc/fafb/fafb-0.swc");
+    const double step = 1000;
+    PointVector resampled = resamplePoints(points, step);
+
+    // roots, branch points and leaves of the original are kept
+    std::vector<int> numChildren(points.size());
+    double cable = 0;
+    for (const auto& p : points) {
+        if (p.parent == POINT_DEFAULT_PARENT) continue;
+        ++numChildren[p.parent];
+        cable += p.distance(points[p.parent]);
+    }
+    size_t roots = 0, kept = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        roots += points[i].parent == POINT_DEFAULT_PARENT;
+        kept += points[i].parent != POINT_DEFAULT_PARENT && numChildren[i] != 1;
+    }
+
+    // interpolated points are rounded to coord_t, so a step may come out
+    // longer by a few units in the last place of the coordinates
+    double magnitude = 0;
+    for (const auto& p : points) magnitude = std::max<double>({ magnitude, std::abs(p.x), std::abs(p.y), std::abs(p.z) });
+    const double tolerance = step * 1e-6 + 4 * std::numeric_limits<coord_t>::epsilon() * magnitude;
+    int firstNewID = 0;
+    for (const auto& p : points) firstNewID = std::max(firstNewID, p.id + 1);
+    size_t segments = 0;
+    for (size_t i = 0; i < resampled.size(); ++i) {
+        int parent = resampled[i].parent;
+        if (parent == POINT_DEFAULT_PARENT) continue;
+        REQUIRE(parent < static_cast<int>(i));
+        // one step along the cable, no longer in a straight line, but the
+        // last of a stretch, which ends on a kept point
+        double length = resampled[i].distance(resampled[parent]);
+        bool interpolated = resampled[i].id >= firstNewID;
+        REQUIRE(length <= (interpolated ? 1 : 1 + RESAMPLE_MIN_GAP) * step + tolerance);
+        // never two points on top of each other, which leaves no direction
+        if (interpolated || resampled[parent].id >= firstNewID) REQUIRE(length > 0);
+        ++segments;
+    }
+    // each stretch is cut into its length in steps, rounded, but at least one
+    REQUIRE_EQ(resampled.size() - segments, roots);
+    REQUIRE(segments <= cable / step + 0.5 * kept);
+    REQUIRE(segments >= cable / step - 0.5 * kept);
+
+    // and through the loader
+    Dataset fafb("tests/test_data/swc/fafb", step);
+    REQUIRE_EQ(fafb.load("fafb-0").size(), segments);
+}
+
+TEST_CASE(test_Neuron_resampled_skeleton_has_no_slivers) {
+    // straight stretches, so path lengths are distances: 2.95 from the
+    // root to the branch point, then 1.07 and 1.49 to the two leaves
+    PointVector points = {
+        Point(1, 0, 0, 0, POINT_DEFAULT_PARENT),
+        Point(2, 0.3, 0, 0, 0),
+        Point(3, 1.7, 0, 0, 1),
+        Point(4, 2.05, 0, 0, 2),
+        Point(5, 2.95, 0, 0, 3),
+        Point(6, 3.6, 0, 0, 4),
+        Point(7, 4.02, 0, 0, 5),
+        Point(8, 2.95, 0.8, 0, 4),
+        Point(9, 2.95, 1.49, 0, 7)
+    };
+    const double step = 1;
+    PointVector resampled = resamplePoints(points, step);
+
+    // 3 steps to the branch point and one to each leaf
+    REQUIRE_EQ(resampled.size(), static_cast<size_t>(6));
+    for (const auto& p : resampled) {
+        if (p.parent == POINT_DEFAULT_PARENT) continue;
+        double length = p.distance(resampled[p.parent]);
+        REQUIRE(length >= RESAMPLE_MIN_GAP * step - 1e-9);
+        REQUIRE(length <= (1 + RESAMPLE_MIN_GAP) * step + 1e-9);
+    }
+}
+
+TEST_CASE(test_Neuron_coarsened_neuron_keeps_one_segment_per_voxel) {
+    Neuron n = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    const double step = 5000;
+    Neuron coarse = coarsenNeuron(n, step);
+    REQUIRE(coarse.size() > 0);
+    REQUIRE(coarse.size() < n.size());
+    REQUIRE_EQ(coarse.tangents.size(), coarse.size());
+    for (const auto& t : coarse.tangents) {
+        double magnitude = std::sqrt(normedDotProduct(t, t));
+        REQUIRE(magnitude == 0 || std::abs(magnitude - 1) < 1e-6);
+    }
+    // means of midpoints stay inside the original box
+    for (int d = 0; d < 3; ++d) {
+        REQUIRE(coarse.bounds.min[d] >= n.bounds.min[d] - 1e-6);
+        REQUIRE(coarse.bounds.max[d] <= n.bounds.max[d] + 1e-6);
+    }
+}
@@ -0,0 +1,96 @@
+#include "Test.hpp"
+#include "NeuronCache.hpp"
+#include "Neuron.hpp"
+#include "Dataset.hpp"
+#include "MatrixIO.hpp"
+#include "PairStream.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+static const std::string BANC_DIR = "tests/test_data/swc/banc";
+static const std::string LOOKUP = "tests/test_data/testLookUp.tsv";
+
+TEST_CASE(test_NeuronCache_hit_after_miss) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV(LOOKUP);
+    Dataset banc(BANC_DIR);
+    NeuronCache cache(1 << 20, &mat);
+
+    auto first = cache.get(banc, "banc-0");
+    auto second = cache.get(banc, "banc-0");
+
+    REQUIRE_EQ(cache.getMisses(), 1u);
+    REQUIRE_EQ(cache.getHits(), 1u);
+    REQUIRE(first.get() == second.get());
+    REQUIRE_EQ(first->size(), loadNeuron(BANC_DIR + "/banc-0.swc").size());
+    REQUIRE(first->selfScore != 0);
+}
+
+TEST_CASE(test_NeuronCache_evicts_least_recently_used) {
+    // too small for more than one neuron
+    Matrix mat = MatrixIO::loadMatrixFromTSV(LOOKUP);
+    Dataset banc(BANC_DIR);
+    NeuronCache cache(0, &mat);
+
+    auto a = cache.get(banc, "banc-0");
+    auto b = cache.get(banc, "banc-1");
+    REQUIRE_EQ(cache.getCount(), static_cast<size_t>(1));
+    REQUIRE_EQ(cache.getEvictions(), 1u);
+
+    // evicted neuron is still usable by the caller holding it
+    REQUIRE(a->size() > 0);
+
+    cache.get(banc, "banc-0");
+    REQUIRE_EQ(cache.getMisses(), 3u);
+    REQUIRE_EQ(cache.getHits(), 0u);
+}
+
+TEST_CASE(test_NeuronCache_prefetch_then_get_hits) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV(LOOKUP);
+    Dataset banc(BANC_DIR);
+    NeuronCache cache(1 << 20, &mat);
+    cache.enablePrefetch(2);
+
+    cache.prefetch(banc, "banc-0");
+    cache.prefetch(banc, "banc-1");
+    cache.prefetch(banc, "banc-0");
+    auto neuron = cache.get(banc, "banc-0");
+
+    REQUIRE_EQ(cache.getPrefetches(), 2u);
+    REQUIRE_EQ(cache.getMisses(), 0u);
+    REQUIRE_EQ(cache.getHits(), 1u);
+    REQUIRE_EQ(neuron->size(), loadNeuron(BANC_DIR + "/banc-0.swc").size());
+}
+
+TEST_CASE(test_PairStream_keeps_input_order) {
+    Dataset banc(BANC_DIR);
+    NeuronCache cache(1 << 20);
+    cache.enablePrefetch(2);
+    std::istringstream in("banc-0 banc-1\nbanc-1 banc-0\n banc-0 banc-0");
+    PairStream pairs(in, cache, banc, banc, 1);
+
+    std::string query, target, seen;
+    while (pairs.next(query, target)) seen += query + ">" + target + ";";
+
+    REQUIRE_EQ(seen, std::string("banc-0>banc-1;banc-1>banc-0;banc-0>banc-0;"));
+    REQUIRE_EQ(cache.getPrefetches(), 2u);
+}
+
+TEST_CASE(test_NeuronCache_failed_load_is_retried) {
+    Dataset banc(BANC_DIR);
+    NeuronCache cache(1 << 20);
+    cache.enablePrefetch(1);
+
+    cache.prefetch(banc, "missing");
+    int failures = 0;
+    for (int i = 0; i < 2; ++i) {
+        try {
+            cache.get(banc, "missing");
+        } catch (const std::runtime_error&) {
+            ++failures;
+        }
+    }
+    REQUIRE_EQ(failures, 2);
+    REQUIRE_EQ(cache.getCount(), static_cast<size_t>(0));
+}
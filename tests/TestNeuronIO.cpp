@@ -0,0 +1,67 @@
+#include "Test.hpp"
+#include "Neuron.hpp"
+#include "NeuronIO.hpp"
+#include "NeuronIndex.hpp"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+TEST_CASE(test_NeuronIO_binary_roundtrip) {
+    char filename[] = "/tmp/test-neuron-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1) { perror("mkstemp"); throw std::runtime_error("Failed to create temp file"); }
+    close(fd);
+
+    Neuron n = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    n.selfScore = 123.5;
+    n.selfScoreKey = 42;
+    NeuronIO::writeBinary(filename, n);
+    Neuron m = NeuronIO::readBinary(filename);
+    std::remove(filename);
+
+    REQUIRE_EQ(m.size(), n.size());
+    REQUIRE_EQ(m.selfScore, 123.5);
+    REQUIRE_EQ(m.selfScoreKey, 42u);
+    for (size_t i = 0; i < n.size(); ++i) {
+        REQUIRE_EQ(m.midpoints[i].id, n.midpoints[i].id);
+        REQUIRE_EQ(m.midpoints[i].x, n.midpoints[i].x);
+        REQUIRE_EQ(m.midpoints[i].z, n.midpoints[i].z);
+        REQUIRE_EQ(m.tangents[i].y, n.tangents[i].y);
+    }
+    for (int d = 0; d < 3; ++d) {
+        REQUIRE_EQ(m.bounds.min[d], n.bounds.min[d]);
+        REQUIRE_EQ(m.bounds.max[d], n.bounds.max[d]);
+    }
+}
+
+TEST_CASE(test_NeuronIO_rejects_swc) {
+    bool threw = false;
+    try {
+        NeuronIO::readBinary("tests/test_data/swc/banc/banc-0.swc");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+TEST_CASE(test_NeuronIO_saved_index_matches_rebuilt) {
+    Neuron n = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    std::string buffer;
+    NeuronIO::encode(n, buffer);
+    REQUIRE(!NeuronIO::decode(buffer.data(), buffer.size(), "no index").index);
+
+    ensureIndex(n);
+    buffer.clear();
+    NeuronIO::encode(n, buffer);
+    Neuron m = NeuronIO::decode(buffer.data(), buffer.size(), "with index");
+    REQUIRE(m.index);
+
+    Neuron query = loadNeuron("tests/test_data/swc/banc/banc-0.swc");
+    for (const auto& qmp : query.midpoints) {
+        coord_t pt[3] = { qmp.x, qmp.y, qmp.z };
+        coord_t built, loaded;
+        REQUIRE_EQ(m.index->nearest(pt, loaded), n.index->nearest(pt, built));
+        REQUIRE_EQ(loaded, built);
+    }
+}
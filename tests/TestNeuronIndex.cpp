@@ -0,0 +1,40 @@
+#include "Test.hpp"
+#include "Neuron.hpp"
+#include "NeuronIndex.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+TEST_CASE(test_NeuronIndex_morton_order_is_a_permutation) {
+    Neuron n = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    std::vector<uint32_t> order = NeuronIndex::mortonOrder(n.midpoints);
+    REQUIRE_EQ(order.size(), n.size());
+    std::sort(order.begin(), order.end());
+    std::vector<uint32_t> expected(n.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    REQUIRE(order == expected);
+}
+
+TEST_CASE(test_NeuronIndex_nearestAll_matches_single_searches) {
+    Neuron a = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    Neuron b = loadNeuron("tests/test_data/swc/fafb/fafb-1.swc");
+    ensureIndex(a);
+    ensureIndex(b);
+
+    std::vector<size_t> nearestIdx;
+    std::vector<coord_t> distSqr;
+    for (const Neuron* query : { &a, &b }) {
+        for (const Neuron* target : { &a, &b }) {
+            target->index->nearestAll(query->midpoints, query->index->curveOrder(), nearestIdx, distSqr);
+            REQUIRE_EQ(nearestIdx.size(), query->size());
+            for (size_t i = 0; i < query->size(); ++i) {
+                const Point& qmp = query->midpoints[i];
+                coord_t pt[3] = { qmp.x, qmp.y, qmp.z };
+                coord_t d;
+                REQUIRE_EQ(nearestIdx[i], target->index->nearest(pt, d));
+                REQUIRE_EQ(distSqr[i], d);
+            }
+        }
+    }
+}
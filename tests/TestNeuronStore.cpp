@@ -0,0 +1,37 @@
+#include "Test.hpp"
+#include "NeuronStore.hpp"
+#include "ThreadPool.hpp"
+#include "Dataset.hpp"
+
+#include <atomic>
+#include <string>
+
+TEST_CASE(test_ThreadPool_parallelFor_covers_range) {
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> hits(100);
+
+    parallelFor(pool, hits.size(), [&](size_t i) { ++hits[i]; });
+
+    for (const auto& h : hits) {
+        REQUIRE_EQ(h.load(), 1);
+    }
+}
+
+TEST_CASE(test_NeuronStore_preload) {
+    Dataset fafb("tests/test_data/swc/fafb");
+    ThreadPool pool(2);
+    NeuronStore store;
+
+    store.preload(fafb, fafb.listNeuronIDs(), pool);
+
+    REQUIRE_EQ(store.getCount(), static_cast<size_t>(2));
+    REQUIRE_EQ(store.get(fafb, "fafb-1")->size(), fafb.load("fafb-1").size());
+
+    bool threw = false;
+    try {
+        store.get(fafb, "missing");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
@@ -0,0 +1,80 @@
+#include "Test.hpp"
+#include "Pipeline.hpp"
+#include "Scoring.hpp"
+#include "PreloadedDataset.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST_CASE(test_Pipeline_allByAll_matches_pairs) {
+    PreloadedDataset fafb("tests/test_data/swc/fafb");
+    const StringVector& ids = fafb.ids;
+
+    DoubleVector scores = allByAll(fafb.mat, fafb.store, fafb.dataset, ids, false, fafb.pool);
+
+    REQUIRE_EQ(scores.size(), ids.size() * ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        for (size_t j = 0; j < ids.size(); ++j) {
+            double expected = scoreNeuronPair(fafb.mat, fafb.get(ids[i]), fafb.get(ids[j]));
+            REQUIRE_EQ(scores[i * ids.size() + j], expected);
+        }
+    }
+}
+
+TEST_CASE(test_Pipeline_topTargets_matches_scoring_every_target) {
+    PreloadedDataset traces(TRACES_DIR);
+    const StringVector& ids = traces.ids;
+
+    for (const auto& queryID : ids) {
+        std::vector<std::pair<double, std::string>> expected;
+        for (const auto& targetID : ids) {
+            expected.emplace_back(scoreNeuronPair(traces.mat, traces.get(queryID), traces.get(targetID)), targetID);
+        }
+        std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        size_t scored = 0;
+        auto hits = topTargets(traces.mat, traces.store, traces.dataset, queryID, traces.dataset, ids, 3, false, 
+                               traces.pool, scored);
+        REQUIRE_EQ(hits.size(), 3u);
+        REQUIRE(scored <= ids.size());
+        for (size_t i = 0; i < hits.size(); ++i) {
+            REQUIRE_EQ(hits[i].second, expected[i].first);
+        }
+    }
+}
+
+TEST_CASE(test_Pipeline_allByAllCoarseToFine_rescores_the_best_pairs) {
+    PreloadedDataset traces(TRACES_DIR);
+    const StringVector& ids = traces.ids;
+    const size_t n = ids.size();
+    DoubleVector exact = allByAll(traces.mat, traces.store, traces.dataset, ids, false, traces.pool);
+
+    // every pair rescored is the exact all-by-all
+    size_t rescored = 0;
+    DoubleVector all = allByAllCoarseToFine(traces.mat, traces.store, traces.dataset, ids, 5, 1, false, 
+                                            traces.pool, rescored);
+    REQUIRE_EQ(rescored, n * (n - 1) / 2);
+    REQUIRE(all == exact);
+
+    DoubleVector some = allByAllCoarseToFine(traces.mat, traces.store, traces.dataset, ids, 5, 0.25, false, 
+                                             traces.pool, rescored);
+    REQUIRE_EQ(rescored, static_cast<size_t>(std::ceil(0.25 * n * (n - 1) / 2)));
+    // exact where rescored, NaN everywhere else
+    size_t scored = 0;
+    for (size_t i = 0; i < n; ++i) {
+        REQUIRE_EQ(some[i * n + i], exact[i * n + i]);
+        for (size_t j = i + 1; j < n; ++j) {
+            if (std::isnan(some[i * n + j])) {
+                REQUIRE(std::isnan(some[j * n + i]));
+                continue;
+            }
+            REQUIRE_EQ(some[i * n + j], exact[i * n + j]);
+            REQUIRE_EQ(some[j * n + i], exact[j * n + i]);
+            ++scored;
+        }
+    }
+    REQUIRE_EQ(scored, rescored);
+}
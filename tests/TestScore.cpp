@@ -3,8 +3,15 @@
 #include "Matrix.hpp"
 #include "MatrixIO.hpp"
 #include "Point.hpp"
+#include "Neuron.hpp"
+#include "FileIO.hpp"
+#include "PreloadedDataset.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 TEST_CASE(test_Scoring_basic) {
     bool doCosine = true;
@@ -27,7 +34,6 @@ TEST_CASE(test_Scoring_basic) {
 
     Matrix mat = MatrixIO::loadMatrixFromTSV("tests/test_data/testLookUp.tsv");
 
-
     double score = scoreNeuronPair(mat, query, target, doCosine);
 
     // NaN check
@@ -38,3 +44,176 @@ TEST_CASE(test_Scoring_basic) {
 
     REQUIRE(selfScore == selfScore);
 }
+
+static double fullSelfScore(const Matrix& mat, const PointVector& pts, bool doSine) {
+    PAVector matchVector = nearestNeighborKDTree(pts, pts, doSine);
+    double res = 0;
+    for (auto& pm : matchVector) {
+        if (pm.queryPointID == -1 || pm.targetPointID == -1) continue;
+        pm.computeRawScore(mat);
+        res += pm.score;
+    }
+    return res;
+}
+
+TEST_CASE(test_Scoring_selfScore_matches_full_pass) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    PointVector pts = loadPoints("tests/test_data/swc/fafb/fafb-0.swc");
+    Neuron n = makeNeuron(pts);
+
+    REQUIRE_EQ(selfScore(mat, n, false), fullSelfScore(mat, pts, false));
+    REQUIRE_EQ(selfScore(mat, n, true), fullSelfScore(mat, pts, true));
+}
+
+TEST_CASE(test_Scoring_neuron_overload_matches_points) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    PointVector queryPoints = loadPoints("tests/test_data/swc/fafb/fafb-0.swc");
+    PointVector targetPoints = loadPoints("tests/test_data/swc/fafb/fafb-1.swc");
+    Neuron query = makeNeuron(queryPoints);
+    Neuron target = makeNeuron(targetPoints);
+    query.selfScore = selfScore(mat, query);
+    target.selfScore = selfScore(mat, target);
+
+    REQUIRE_EQ(scoreNeuronPair(mat, query, target), 
+               scoreNeuronPair(mat, queryPoints, targetPoints));
+}
+
+// directional score from an uncapped search, every match looked up
+static double uncappedDirectionalScore(const Matrix& mat, const Neuron& query, const Neuron& target) {
+    double res = 0;
+    for (const auto& match : nearestNeighborKDTree(query, target)) res += mat.score(match.distance, match.angleMeasure);
+    return res;
+}
+
+// the matrix with its last row set to the mean of the original's
+static Matrix withConstantLastRow(Matrix mat) {
+    double far = mat.farScore();
+    for (size_t j = 0; j < mat.cols(); ++j) mat.at(mat.rows() - 1, j) = far;
+    return mat;
+}
+
+TEST_CASE(test_Scoring_matches_beyond_last_bin_score_far) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    PointVector queryPoints = loadPoints("tests/test_data/swc/fafb/fafb-0.swc");
+    PointVector targetPoints = queryPoints;
+    // every target segment far beyond the last distance bin
+    for (auto& p : targetPoints) p.x += 100 * mat.maxDistance();
+    Neuron query = makeNeuron(queryPoints);
+    Neuron target = makeNeuron(targetPoints);
+
+    // the last row depends on angle, so only an opted-in cap scores the mean
+    REQUIRE(!mat.capsFarMatches());
+    REQUIRE_EQ(directionalScore(mat, query, target), uncappedDirectionalScore(mat, query, target));
+    mat.setCapFarMatches(true);
+    REQUIRE_EQ(directionalScore(mat, query, target), query.size() * mat.farScore());
+
+    // matching on its own is not capped, training needs the distances
+    for (const auto& match : nearestNeighborKDTree(query, target)) {
+        REQUIRE(match.targetPointID != -1);
+        REQUIRE(match.distance > mat.maxDistance());
+    }
+}
+
+TEST_CASE(test_Scoring_capped_search_matches_uncapped_scores) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    std::vector<Neuron> neurons;
+    for (const char* path : { "tests/test_data/swc/fafb/fafb-0.swc", "tests/test_data/swc/fafb/fafb-1.swc", 
+                              "tests/test_data/swc/banc/banc-0.swc", "tests/test_data/swc/banc/banc-1.swc" }) {
+        neurons.push_back(loadNeuron(path));
+    }
+    Matrix constant = withConstantLastRow(mat);
+    REQUIRE(constant.capsFarMatches());
+    Matrix capped = mat;
+    capped.setCapFarMatches(true);
+    for (const auto& query : neurons) {
+        for (const auto& target : neurons) {
+            // by default every match is looked up, as in the baseline
+            REQUIRE_EQ(directionalScore(mat, query, target), uncappedDirectionalScore(mat, query, target));
+            // a constant last row makes the cap exact
+            double exact = uncappedDirectionalScore(constant, query, target);
+            REQUIRE(std::abs(directionalScore(constant, query, target) - exact) <= 1e-9 * std::abs(exact));
+            // opted in, only matches beyond the last edge move, by less
+            // than the spread of the last row each
+            double spread = 0;
+            for (size_t j = 0; j < mat.cols(); ++j) {
+                spread = std::max(spread, std::abs(mat.at(mat.rows() - 1, j) - mat.farScore()));
+            }
+            size_t far = 0;
+            for (const auto& match : nearestNeighborKDTree(query, target)) far += match.distance > mat.maxDistance();
+            double uncapped = uncappedDirectionalScore(mat, query, target);
+            REQUIRE(std::abs(directionalScore(capped, query, target) - uncapped) <= far * spread + 1e-9 * std::abs(uncapped));
+        }
+    }
+}
+
+TEST_CASE(test_Scoring_pairs_out_of_reach_score_in_constant_time) {
+    Matrix mat = MatrixIO::loadMatrixFromTSV("regression-tests/input/smat.fcwb.tsv");
+    PointVector queryPoints = loadPoints("tests/test_data/swc/fafb/fafb-0.swc");
+    Neuron query = makeNeuron(queryPoints);
+    query.selfScore = selfScore(mat, query);
+
+    // boxes just inside the last bin edge of each other are searched
+    PointVector nearPoints = queryPoints;
+    for (auto& p : nearPoints) p.y += query.bounds.max[1] - query.bounds.min[1] + 0.9 * mat.maxDistance();
+    Neuron near = makeNeuron(nearPoints);
+    near.selfScore = query.selfScore;
+    REQUIRE(!outOfReach(mat, query, near));
+
+    PointVector farPoints = queryPoints;
+    for (auto& p : farPoints) p.y += query.bounds.max[1] - query.bounds.min[1] + 1.1 * mat.maxDistance();
+    Neuron far = makeNeuron(farPoints);
+    far.selfScore = query.selfScore;
+    REQUIRE(outOfReach(mat, query, far));
+    REQUIRE(outOfReach(mat, far, query));
+
+    // the last row depends on angle, so the pair is searched in full
+    uint64_t before = outOfReachPairCount();
+    scoreNeuronPair(mat, query, near);
+    REQUIRE_EQ(outOfReachPairCount(), before);
+    double uncapped = pairScore(uncappedDirectionalScore(mat, query, far), uncappedDirectionalScore(mat, far, query), 
+                                query, far);
+    REQUIRE_EQ(scoreNeuronPair(mat, query, far), uncapped);
+    REQUIRE_EQ(outOfReachPairCount(), before);
+
+    // with a constant last row the constant-time score is exact
+    Matrix constant = withConstantLastRow(mat);
+    double exact = pairScore(uncappedDirectionalScore(constant, query, far), 
+                             uncappedDirectionalScore(constant, far, query), query, far);
+    REQUIRE(std::abs(scoreNeuronPair(constant, query, far) - exact) <= 1e-9 * std::abs(exact));
+    REQUIRE_EQ(outOfReachPairCount(), before + 1);
+
+    // and opted into, it scores the pair as the capped search would
+    mat.setCapFarMatches(true);
+    REQUIRE_EQ(scoreNeuronPair(mat, query, far), 
+               pairScore(directionalScore(mat, query, far), directionalScore(mat, far, query), query, far));
+    REQUIRE_EQ(outOfReachPairCount(), before + 2);
+}
+
+TEST_CASE(test_Scoring_bound_is_never_below_the_score) {
+    PreloadedDataset traces(TRACES_DIR);
+
+    ScoreBound bound(traces.mat);
+    // rows beyond 12 have no positive entry
+    REQUIRE_EQ(bound.positiveReach(), 12.0);
+    for (const auto& a : traces.ids) {
+        for (const auto& b : traces.ids) {
+            const Neuron& query = traces.get(a);
+            const Neuron& target = traces.get(b);
+            REQUIRE(bound.directional(query, target.bounds) >= directionalScore(traces.mat, query, target));
+            REQUIRE(bound.pair(query, target) >= scoreNeuronPair(traces.mat, query, target));
+        }
+    }
+}
+
+TEST_CASE(test_Scoring_segment_sine_matches_acos) {
+    Neuron n = loadNeuron("tests/test_data/swc/fafb/fafb-0.swc");
+    for (size_t i = 1; i < n.size(); ++i) {
+        const Point& u = n.tangents[i - 1];
+        const Point& v = n.tangents[i];
+        double cosine = segmentAngleMeasure(u, v, false);
+        if (cosine < 0) continue;
+        REQUIRE(std::abs(segmentAngleMeasure(u, v, true) - std::sin(std::acos(cosine))) < 1e-7);
+    }
+    Point zero(1, 0, 0, 0, -1);
+    REQUIRE_EQ(segmentAngleMeasure(zero, n.tangents[0], true), -1.0);
+}